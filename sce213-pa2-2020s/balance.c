@@ -0,0 +1,119 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Load balancers for the multi-processor simulation
+ *
+ * DESCRIPTION
+ *   push:  Every BALANCE_INTERVAL ticks, move processes from the busiest
+ *          CPU to the idlest one until their loads are within one process.
+ *   steal: When a CPU runs out of processes, steal one from the busiest CPU.
+ *   all:   Both of the above.
+ *   none:  Processes stay on the CPU they are forked or woken up on.
+ *
+ *   The load of a CPU is the number of processes running or ready on it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+
+#include "process.h"
+#include "resource.h"
+
+#include "sched.h"
+#include "sim.h"
+
+#define BALANCE_INTERVAL	4
+
+static unsigned int __busiest_cpu(struct sim_context *ctx)
+{
+	unsigned int busiest = 0;
+
+	for (unsigned int cpu = 1; cpu < ctx->nr_cpus; cpu++) {
+		if (ctx->cpus[cpu].nr_running > ctx->cpus[busiest].nr_running) {
+			busiest = cpu;
+		}
+	}
+	return busiest;
+}
+
+static unsigned int __idlest_cpu(struct sim_context *ctx)
+{
+	unsigned int idlest = 0;
+
+	for (unsigned int cpu = 1; cpu < ctx->nr_cpus; cpu++) {
+		if (ctx->cpus[cpu].nr_running < ctx->cpus[idlest].nr_running) {
+			idlest = cpu;
+		}
+	}
+	return idlest;
+}
+
+static void push_tick(struct sim_context *ctx)
+{
+	if (ctx->ticks % BALANCE_INTERVAL) return;
+
+	/* Each migration reduces the imbalance, so this terminates */
+	while (true) {
+		unsigned int busiest = __busiest_cpu(ctx);
+		unsigned int idlest = __idlest_cpu(ctx);
+
+		if (ctx->cpus[busiest].nr_running <
+				ctx->cpus[idlest].nr_running + 2) break;
+
+		if (!sim_migrate(ctx, busiest, idlest)) break;
+	}
+}
+
+static bool steal_idle(struct sim_context *ctx)
+{
+	unsigned int busiest = __busiest_cpu(ctx);
+
+	/* Leave the one that the busiest is running */
+	if (ctx->cpus[busiest].nr_running < 2) return false;
+
+	return sim_migrate(ctx, busiest, ctx->cpu);
+}
+
+static struct sim_balancer balancers[] = {
+	{
+		.name = "none",
+	},
+	{
+		.name = "push",
+		.tick = push_tick,
+	},
+	{
+		.name = "steal",
+		.idle = steal_idle,
+	},
+	{
+		.name = "all",
+		.idle = steal_idle,
+		.tick = push_tick,
+	},
+};
+
+struct sim_balancer *sim_find_balancer(const char *name)
+{
+	for (int i = 0; i < sizeof(balancers) / sizeof(*balancers); i++) {
+		if (strcmp(balancers[i].name, name) == 0) return balancers + i;
+	}
+	return NULL;
+}
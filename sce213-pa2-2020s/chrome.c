@@ -0,0 +1,196 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Chrome trace-event JSON writer. See trace.h
+ *
+ * DESCRIPTION
+ *   Consecutive ticks of a process on a CPU are merged into one slice, so
+ *   each CPU keeps the slice being extended until something else shows up
+ *   on the CPU. Slices are written when they are closed, so they are not
+ *   in the order of time in the file, which the viewers do not mind.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "trace.h"
+
+#define US_PER_TICK		1000
+
+#define CHROME_CPUS		0	/* Trace process holding the CPU tracks */
+#define CHROME_PRIOS	1	/* Trace process holding the priority counters */
+
+struct chrome_slice {
+	bool open;
+	bool switching;		/* Context switch to @pid rather than its run */
+	int pid;
+	unsigned int start;
+	unsigned int end;
+};
+
+struct sim_chrome {
+	FILE *file;
+	bool first;
+	unsigned int nr_cpus;
+	struct chrome_slice *slices;	/* Per CPU */
+};
+
+static void __begin_event(struct sim_chrome *chrome)
+{
+	fprintf(chrome->file, chrome->first ? "\n  " : ",\n  ");
+	chrome->first = false;
+}
+
+static void __close_slice(struct sim_chrome *chrome, unsigned int cpu)
+{
+	struct chrome_slice *slice = chrome->slices + cpu;
+
+	if (!slice->open) return;
+
+	__begin_event(chrome);
+	fprintf(chrome->file, "{\"name\": \"%s%d\", \"cat\": \"%s\", \"ph\": \"X\", "
+			"\"pid\": %d, \"tid\": %u, \"ts\": %llu, \"dur\": %llu, \"args\": {\"pid\": %d}}",
+			slice->switching ? "switch to " : "", slice->pid,
+			slice->switching ? "switch" : "run", CHROME_CPUS, cpu,
+			(unsigned long long)slice->start * US_PER_TICK,
+			(unsigned long long)(slice->end - slice->start) * US_PER_TICK,
+			slice->pid);
+	slice->open = false;
+}
+
+static void __extend_slice(struct sim_chrome *chrome, const struct sim_event *ev,
+		bool switching, unsigned int nr_ticks)
+{
+	struct chrome_slice *slice = chrome->slices + ev->cpu;
+
+	if (slice->open && slice->pid == ev->pid &&
+			slice->switching == switching && slice->end == ev->tick) {
+		slice->end += nr_ticks;
+		return;
+	}
+
+	__close_slice(chrome, ev->cpu);
+
+	slice->open = true;
+	slice->switching = switching;
+	slice->pid = ev->pid;
+	slice->start = ev->tick;
+	slice->end = ev->tick + nr_ticks;
+}
+
+static void __instant(struct sim_chrome *chrome, const struct sim_event *ev,
+		const char *name, const char *arg)
+{
+	__begin_event(chrome);
+	fprintf(chrome->file, "{\"name\": \"%s\", \"cat\": \"event\", \"ph\": \"i\", \"s\": \"t\", "
+			"\"pid\": %d, \"tid\": %u, \"ts\": %llu, \"args\": {\"pid\": %d",
+			name, CHROME_CPUS, ev->cpu, (unsigned long long)ev->tick * US_PER_TICK, ev->pid);
+	if (arg) fprintf(chrome->file, ", \"%s\": %d", arg, ev->arg);
+	fprintf(chrome->file, "}}");
+}
+
+struct sim_chrome *sim_chrome_open(FILE *file, unsigned int nr_cpus)
+{
+	struct sim_chrome *chrome = malloc(sizeof(*chrome));
+
+	if (!chrome) return NULL;
+
+	chrome->slices = calloc(nr_cpus, sizeof(*chrome->slices));
+	if (!chrome->slices) {
+		free(chrome);
+		return NULL;
+	}
+	chrome->file = file;
+	chrome->first = true;
+	chrome->nr_cpus = nr_cpus;
+
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+	__begin_event(chrome);
+	fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+			"\"args\": {\"name\": \"CPUs\"}}", CHROME_CPUS);
+	__begin_event(chrome);
+	fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, "
+			"\"args\": {\"name\": \"Priorities\"}}", CHROME_PRIOS);
+
+	for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+		__begin_event(chrome);
+		fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, "
+				"\"tid\": %u, \"args\": {\"name\": \"CPU %u\"}}",
+				CHROME_CPUS, cpu, cpu);
+	}
+	return chrome;
+}
+
+void sim_chrome_append(struct sim_chrome *chrome, const struct sim_event *ev)
+{
+	if (ev->cpu >= chrome->nr_cpus) return;
+
+	switch (ev->type) {
+	case SIM_EVENT_RUN:
+		__extend_slice(chrome, ev, false, ev->arg);
+		break;
+	case SIM_EVENT_SWITCH:
+		__extend_slice(chrome, ev, true, 1);
+		break;
+	case SIM_EVENT_IDLE:
+		__close_slice(chrome, ev->cpu);
+		break;
+	case SIM_EVENT_FORK:
+		__instant(chrome, ev, "fork", NULL);
+		break;
+	case SIM_EVENT_EXIT:
+		__instant(chrome, ev, "exit", NULL);
+		break;
+	case SIM_EVENT_BLOCK:
+		__close_slice(chrome, ev->cpu);
+		__instant(chrome, ev, "block", NULL);
+		break;
+	case SIM_EVENT_ACQUIRE:
+		__instant(chrome, ev, "acquire", "resource");
+		break;
+	case SIM_EVENT_RELEASE:
+		__instant(chrome, ev, "release", "resource");
+		break;
+	case SIM_EVENT_MIGRATE:
+		__instant(chrome, ev, "migrate", NULL);
+		break;
+	case SIM_EVENT_IO:
+		__instant(chrome, ev, "io", "device");
+		break;
+	case SIM_EVENT_IO_DONE:
+		__instant(chrome, ev, "io done", "device");
+		break;
+	case SIM_EVENT_PRIO:
+		__begin_event(chrome);
+		fprintf(chrome->file, "{\"name\": \"prio %d\", \"ph\": \"C\", \"pid\": %d, "
+				"\"ts\": %llu, \"args\": {\"prio\": %d}}",
+				ev->pid, CHROME_PRIOS, (unsigned long long)ev->tick * US_PER_TICK, ev->arg);
+		break;
+	}
+}
+
+void sim_chrome_close(struct sim_chrome *chrome)
+{
+	for (unsigned int cpu = 0; cpu < chrome->nr_cpus; cpu++) {
+		__close_slice(chrome, cpu);
+	}
+	fprintf(chrome->file, "\n]}\n");
+	fflush(chrome->file);
+
+	free(chrome->slices);
+	free(chrome);
+}
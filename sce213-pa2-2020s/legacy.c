@@ -0,0 +1,99 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+
+#include "process.h"
+#include "resource.h"
+
+#include "sched.h"
+#include "legacy.h"
+
+struct legacy_wrapper {
+	struct scheduler sched;
+	struct legacy_scheduler *legacy;
+};
+
+static inline struct legacy_scheduler *__legacy(struct sim_context *ctx)
+{
+	return container_of(ctx->sched, struct legacy_wrapper, sched)->legacy;
+}
+
+static int __legacy_initialize(struct sim_context *ctx)
+{
+	return __legacy(ctx)->initialize();
+}
+
+static void __legacy_finalize(struct sim_context *ctx)
+{
+	__legacy(ctx)->finalize();
+}
+
+static void __legacy_forked(struct sim_context *ctx, struct process *p)
+{
+	__legacy(ctx)->forked(p);
+}
+
+static void __legacy_exiting(struct sim_context *ctx, struct process *p)
+{
+	__legacy(ctx)->exiting(p);
+}
+
+static struct process *__legacy_schedule(struct sim_context *ctx)
+{
+	return __legacy(ctx)->schedule();
+}
+
+static bool __legacy_acquire(struct sim_context *ctx, int resource_id)
+{
+	return __legacy(ctx)->acquire(resource_id);
+}
+
+static void __legacy_release(struct sim_context *ctx, int resource_id)
+{
+	__legacy(ctx)->release(resource_id);
+}
+
+static unsigned int __legacy_slice(struct sim_context *ctx)
+{
+	return __legacy(ctx)->slice();
+}
+
+struct scheduler *legacy_scheduler_wrap(struct legacy_scheduler *legacy)
+{
+	struct legacy_wrapper *w = malloc(sizeof(*w));
+	assert(w);
+
+	w->legacy = legacy;
+	w->sched = (struct scheduler) {
+		.name = legacy->name,
+		.initialize = legacy->initialize ? __legacy_initialize : NULL,
+		.finalize = legacy->finalize ? __legacy_finalize : NULL,
+		.forked = legacy->forked ? __legacy_forked : NULL,
+		.exiting = legacy->exiting ? __legacy_exiting : NULL,
+		.schedule = legacy->schedule ? __legacy_schedule : NULL,
+		.acquire = legacy->acquire ? __legacy_acquire : NULL,
+		.release = legacy->release ? __legacy_release : NULL,
+		.slice = legacy->slice ? __legacy_slice : NULL,
+	};
+
+	return &w->sched;
+}
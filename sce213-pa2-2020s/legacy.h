@@ -0,0 +1,69 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __LEGACY_H__
+#define __LEGACY_H__
+
+/***********************************************************************
+ * Compatibility layer for schedulers without the simulation context
+ *
+ * DESCRIPTION
+ *   Schedulers used to access the simulator through global variables
+ *   (current, readyqueue, resources, ticks, and quiet), and their callbacks
+ *   were not given the context. To keep using such a scheduler,
+ *   - replace the extern declarations of the variables with
+ *     #include "legacy.h",
+ *   - define the scheduler with struct legacy_scheduler instead of
+ *     struct scheduler, and
+ *   - pass legacy_scheduler_wrap() of it to sim_init().
+ *
+ *   Such schedulers served the resources as mutexes by themselves through
+ *   @owner of struct resource, and it is still there for them. Every
+ *   resource is then a mutex whatever the script says about its units
+ *   and shared acquisitions. NR_RESOURCES is the number of resources in
+ *   the simulation rather than a constant, so declare no array with it.
+ *
+ *   The variables are mapped to the context of the simulation running on
+ *   the calling thread. Static variables of the scheduler are still shared
+ *   by all simulations, though, so run such a scheduler one simulation at
+ *   a time unless it is stateless.
+ */
+#include "sim.h"
+
+struct legacy_scheduler {
+	const char *name;
+	int (*initialize)(void);
+	void (*finalize)(void);
+	void (*forked)(struct process *);
+	void (*exiting)(struct process *);
+	struct process *(*schedule)(void);
+	bool (*acquire)(int);
+	void (*release)(int);
+	unsigned int (*slice)(void);
+};
+
+/**
+ * Return a struct scheduler that calls back the functions of @legacy
+ */
+struct scheduler *legacy_scheduler_wrap(struct legacy_scheduler *legacy);
+
+#define current		(sim_this()->current)
+#define readyqueue	(sim_this()->readyqueue)
+#define resources	(sim_this()->resources)
+#define ticks		(sim_this()->ticks)
+#define quiet		(sim_this()->quiet)
+#define NR_RESOURCES	(sim_this()->nr_resources)
+
+#endif
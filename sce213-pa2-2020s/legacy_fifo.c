@@ -0,0 +1,145 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * FIFO scheduler written against the global variables
+ *
+ * DESCRIPTION
+ *   The FIFO scheduler and the FCFS resource functions as they were before
+ *   the simulation context, ported to legacy.h as the file describes and
+ *   nothing more. It simulates the script given as sched -f does, so
+ *   `make test` compares the two to keep legacy.h working.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+
+#include "process.h"
+#include "resource.h"
+
+#include "sched.h"
+#include "legacy.h"
+
+static bool fcfs_acquire(int resource_id)
+{
+	struct resource *r = resources + resource_id;
+
+	assert(resource_id < NR_RESOURCES);
+
+	if (!r->owner) {
+		/* This resource is not owned by any one. Take it! */
+		r->owner = current;
+		return true;
+	}
+
+	/* OK, this resource is taken by @r->owner. */
+
+	/* Update the current process state */
+	current->status = PROCESS_WAIT;
+
+	/* And append current to waitqueue */
+	list_add_tail(&current->list, &r->waitqueue);
+
+	return false;
+}
+
+static void fcfs_release(int resource_id)
+{
+	struct resource *r = resources + resource_id;
+
+	/* Ensure that the owner process is releasing the resource */
+	assert(r->owner == current);
+
+	/* Un-own this resource */
+	r->owner = NULL;
+
+	/* Let's wake up ONE waiter (if exists) that came first */
+	if (!list_empty(&r->waitqueue)) {
+		struct process *waiter =
+				list_first_entry(&r->waitqueue, struct process, list);
+
+		assert(waiter->status == PROCESS_WAIT);
+
+		list_del_init(&waiter->list);
+		waiter->status = PROCESS_READY;
+		list_add_tail(&waiter->list, &readyqueue);
+	}
+}
+
+static int fifo_initialize(void)
+{
+	return 0;
+}
+
+static void fifo_finalize(void)
+{
+}
+
+static struct process *fifo_schedule(void)
+{
+	struct process *next = NULL;
+
+	if (!current || current->status == PROCESS_WAIT) {
+		goto pick_next;
+	}
+
+	/* The current process has remaining lifetime. Schedule it again */
+	if (current->age < current->lifespan) {
+		return current;
+	}
+
+pick_next:
+	if (!list_empty(&readyqueue)) {
+		next = list_first_entry(&readyqueue, struct process, list);
+		list_del_init(&next->list);
+	}
+
+	return next;
+}
+
+static struct legacy_scheduler fifo_scheduler = {
+	.name = "FIFO",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.initialize = fifo_initialize,
+	.finalize = fifo_finalize,
+	.schedule = fifo_schedule,
+};
+
+int main(int argc, char * const argv[])
+{
+	struct sim_context ctx;
+	int ret;
+
+	if (argc != 2) {
+		printf("Usage: %s [process script file]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	sim_init(&ctx, legacy_scheduler_wrap(&fifo_scheduler), false);
+	if (!sim_load_script(&ctx, argv[1])) return EXIT_FAILURE;
+
+	ret = sim_run(&ctx);
+	if (ret < 0) return EXIT_FAILURE;
+
+	sim_dump_status(&ctx);
+	sim_destroy(&ctx);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/**********************************************************************
+ * Copyright (c) 2019
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+
+#include "process.h"
+#include "resource.h"
+
+#include "sched.h"
+#include "sim.h"
+
+static void __print_usage(char * const name)
+{
+	printf("Usage: %s {-q} {-e} {-F} {-n ncpus} {-L balancer} {-o key=value,...} {-Q quantum} {-x cost} {-D policy} {-M format} {-b file} {-T file} -[f|s|S|r|p|c|i|C|m|E|t] [process script file]\n", name);
+	printf("\n");
+	printf("  -q: Run quietly\n");
+	printf("  -e: Skip the ticks in which nothing happens (event-driven)\n");
+	printf("  -F: Stream the script from a pipe or FIFO (- for stdin) while simulating\n");
+	printf("  -n: Simulate ncpus CPUs with per-CPU ready queues (default: 1)\n");
+	printf("  -L: Balance the load among CPUs with none, push, steal, or all (default)\n");
+	printf("  -o: Tune the scheduler with options (e.g., -o latency=8,min_granularity=1)\n");
+	printf("  -Q: Time quantum of Round-robin and MLFQ in ticks (default: 1)\n");
+	printf("  -x: Ticks lost on each context switch, shown as ~ (default: 0)\n");
+	printf("  -D: On a deadlock, report, abort the simulation, or kill a process (default: report)\n");
+	printf("  -b: Write the binary event log to file instead of the timeline (see tracecat)\n");
+	printf("  -T: Write the Chrome trace-event JSON to file for chrome://tracing or Perfetto\n");
+	printf("  -M: Report the metrics in table, csv, or json. Only the report with -q\n\n");
+	printf("  -f: Use FIFO scheduler (default)\n");
+	printf("  -s: Use SJF scheduler\n");
+	printf("  -S: Use SRTF scheduler\n");
+	printf("  -r: Use Round-robin scheduler\n");
+	printf("  -p: Use Priority scheduler\n");
+	printf("  -c: Use Priority with PCP scheduler\n");
+	printf("  -i: Use Priority with PIP scheduler\n");
+	printf("  -C: Use CFS-like fair scheduler\n");
+	printf("  -m: Use Multi-level feedback queue scheduler\n");
+	printf("  -E: Use Earliest-deadline first scheduler\n");
+	printf("  -t: Use Stride (or lottery with -o lottery=1) scheduler\n");
+	printf("\n");
+}
+
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	char *scriptfile;
+	struct sim_context ctx;
+	struct scheduler *sched = sim_find_scheduler('f');
+	bool quiet = false;
+	bool event_driven = false;
+	bool streaming = false;
+	int nr_cpus = 1;
+	struct sim_balancer *balancer = sim_find_balancer("all");
+	char *options = NULL;
+	struct sim_report *report = NULL;
+	char *eventfile = NULL;
+	char *chromefile = NULL;
+	int quantum = 1;
+	int switch_cost = 0;
+	int deadlock = SIM_DEADLOCK_REPORT;
+	int ret;
+
+	while ((opt = getopt(argc, argv, "qeFn:L:o:Q:x:D:M:b:T:fsSrpicCmEth")) != -1) {
+		switch (opt) {
+		case 'q':
+			quiet = true;
+			break;
+		case 'e':
+			event_driven = true;
+			break;
+		case 'F':
+			streaming = true;
+			break;
+		case 'n':
+			nr_cpus = atoi(optarg);
+			break;
+		case 'L':
+			balancer = sim_find_balancer(optarg);
+			if (!balancer) {
+				fprintf(stderr, "Unknown balancer %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'o':
+			options = optarg;
+			break;
+		case 'Q':
+			quantum = atoi(optarg);
+			break;
+		case 'x':
+			switch_cost = atoi(optarg);
+			break;
+		case 'D':
+			deadlock = sim_find_deadlock_policy(optarg);
+			if (deadlock < 0) {
+				fprintf(stderr, "Unknown deadlock policy %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'b':
+			eventfile = optarg;
+			break;
+		case 'T':
+			chromefile = optarg;
+			break;
+		case 'M':
+			report = sim_find_report(optarg);
+			if (!report) {
+				fprintf(stderr, "Unknown metrics format %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'f':
+		case 's':
+		case 'S':
+		case 'r':
+		case 'p':
+		case 'i':
+		case 'c':
+		case 'C':
+		case 'm':
+		case 'E':
+		case 't':
+			sched = sim_find_scheduler(opt);
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc || nr_cpus <= 0 || quantum <= 0 || switch_cost < 0) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	scriptfile = argv[optind];
+
+	sim_init(&ctx, sched, quiet);
+	ctx.event_driven = event_driven;
+	ctx.nr_cpus = nr_cpus;
+	ctx.balancer = balancer;
+	ctx.options = options;
+	ctx.quantum = quantum;
+	ctx.switch_cost = switch_cost;
+	ctx.deadlock = deadlock;
+	if (eventfile) {
+		ctx.events = fopen(eventfile, "wb");
+		if (!ctx.events) {
+			fprintf(stderr, "Cannot open %s\n", eventfile);
+			return EXIT_FAILURE;
+		}
+	}
+	if (chromefile) {
+		ctx.chrome = fopen(chromefile, "w");
+		if (!ctx.chrome) {
+			fprintf(stderr, "Cannot open %s\n", chromefile);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (streaming) {
+		if (!sim_stream_script(&ctx, scriptfile)) return EXIT_FAILURE;
+	} else if (!sim_load_script(&ctx, scriptfile)) {
+		return EXIT_FAILURE;
+	}
+
+	/* Dump what is left when aborted on a deadlock */
+	ret = sim_run(&ctx);
+	if (ret < 0) {
+		return EXIT_FAILURE;
+	}
+	if (!quiet || !report) sim_dump_status(&ctx);
+	if (report) report->print(&ctx, stdout);
+
+	sim_destroy(&ctx);
+	if (ctx.events) fclose(ctx.events);
+	if (ctx.chrome) fclose(ctx.chrome);
+
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
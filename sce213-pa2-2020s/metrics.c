@@ -0,0 +1,378 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Scheduling metrics of a finished simulation
+ *
+ * DESCRIPTION
+ *   For each exited process (see struct sim_record),
+ *
+ *   turnaround:  finish - arrival
+ *   waiting:     turnaround - lifespan - io. Includes the ticks blocked on
+ *                resources and lost by context switches, but not the ticks
+ *                waiting for I/O devices
+ *   response:    first dispatch - arrival
+ *
+ *   Over all the processes, report the mean, median, p95, p99, and max of
+ *   them (nearest-rank percentiles), the throughput, the CPU utilization,
+ *   and Jain's fairness index of (lifespan + io) / turnaround, which is 1
+ *   when all the processes are slowed down alike. The ticks blocked on each
+ *   resource and the requests served by each device are reported as well.
+ *
+ *   Priority inversions (see struct sim_record) are reported with their
+ *   ticks per process, and the number of them, the longest one, and the
+ *   longest blocking chain over all. So are the deadlocks, and the processes
+ *   killed to break them, which are marked as such and whose lifespan is
+ *   the ticks they ran until then.
+ *
+ *   table is for human, csv prints the processes and then the aggregates
+ *   in "metric,value" after an empty line, and json prints one object.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+
+#include "process.h"
+#include "resource.h"
+
+#include "sched.h"
+#include "sim.h"
+
+enum {
+	METRIC_TURNAROUND,
+	METRIC_WAITING,
+	METRIC_RESPONSE,
+	NR_METRICS,
+};
+
+static const char *__metric_names[NR_METRICS] = {
+	"turnaround", "waiting", "response",
+};
+
+struct distribution {
+	double mean;
+	unsigned int p50;
+	unsigned int p95;
+	unsigned int p99;
+	unsigned int max;
+};
+
+struct summary {
+	unsigned int nr_processes;
+	unsigned int capacity;		/* ticks x CPUs */
+	unsigned int nr_busy;
+	double throughput;			/* Processes per 100 ticks */
+	double utilization;
+	double fairness;
+	struct distribution dists[NR_METRICS];
+};
+
+static unsigned int __metric(struct sim_record *rec, int metric)
+{
+	switch (metric) {
+	case METRIC_TURNAROUND:
+		return rec->finish - rec->arrival;
+	case METRIC_WAITING:
+		return rec->finish - rec->arrival - rec->lifespan - rec->io;
+	case METRIC_RESPONSE:
+		return rec->first_run - rec->arrival;
+	}
+	return 0;
+}
+
+static int __compare_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a;
+	unsigned int y = *(const unsigned int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * Nearest-rank @percent-th percentile of sorted @values
+ */
+static unsigned int __percentile(unsigned int *values, unsigned int nr, unsigned int percent)
+{
+	unsigned int rank = (nr * percent + 99) / 100;
+
+	return values[rank ? rank - 1 : 0];
+}
+
+static void __summarize(struct sim_context *ctx, struct summary *s)
+{
+	struct sim_record *rec;
+	unsigned int *values;
+	double sum = 0, sum_squares = 0;
+
+	memset(s, 0x00, sizeof(*s));
+
+	list_for_each_entry(rec, &ctx->records, list) {
+		double share = rec->finish > rec->arrival ?
+				(double)(rec->lifespan + rec->io) / (rec->finish - rec->arrival) : 1.0;
+
+		sum += share;
+		sum_squares += share * share;
+		s->nr_processes++;
+	}
+
+	for (unsigned int cpu = 0; cpu < ctx->nr_cpus; cpu++) {
+		s->nr_busy += ctx->cpus[cpu].nr_busy;
+	}
+	s->capacity = ctx->ticks * ctx->nr_cpus;
+
+	if (ctx->ticks) {
+		s->throughput = s->nr_processes * 100.0 / ctx->ticks;
+		s->utilization = s->nr_busy * 100.0 / s->capacity;
+	}
+	if (!s->nr_processes) return;
+
+	s->fairness = sum * sum / (s->nr_processes * sum_squares);
+
+	values = malloc(sizeof(*values) * s->nr_processes);
+	for (int metric = 0; metric < NR_METRICS; metric++) {
+		struct distribution *d = s->dists + metric;
+		unsigned int i = 0;
+		double total = 0;
+
+		list_for_each_entry(rec, &ctx->records, list) {
+			values[i] = __metric(rec, metric);
+			total += values[i++];
+		}
+		qsort(values, s->nr_processes, sizeof(*values), __compare_uint);
+
+		d->mean = total / s->nr_processes;
+		d->p50 = __percentile(values, s->nr_processes, 50);
+		d->p95 = __percentile(values, s->nr_processes, 95);
+		d->p99 = __percentile(values, s->nr_processes, 99);
+		d->max = values[s->nr_processes - 1];
+	}
+	free(values);
+}
+
+
+static void table_print(struct sim_context *ctx, FILE *out)
+{
+	struct summary s;
+	struct sim_record *rec;
+
+	__summarize(ctx, &s);
+
+	fprintf(out, "***** METRICS *********\n");
+	fprintf(out, "  pid  arrival  first  finish  lifespan  turnaround  waiting  response  blocked  inverted  chain      io\n");
+	list_for_each_entry(rec, &ctx->records, list) {
+		fprintf(out, "%3d.%-2u %7u %6u %7u %9u %11u %8u %9u %8u %9u %6u %7u%s\n",
+				rec->pid, rec->job, rec->arrival, rec->first_run, rec->finish,
+				rec->lifespan, __metric(rec, METRIC_TURNAROUND),
+				__metric(rec, METRIC_WAITING), __metric(rec, METRIC_RESPONSE),
+				rec->blocked, rec->inversion, rec->chain, rec->io,
+				rec->killed ? "  killed" : "");
+	}
+	fprintf(out, "\n");
+
+	fprintf(out, "              mean    p50    p95    p99    max\n");
+	for (int metric = 0; metric < NR_METRICS; metric++) {
+		struct distribution *d = s.dists + metric;
+
+		fprintf(out, "%-10s %7.2f %6u %6u %6u %6u\n", __metric_names[metric],
+				d->mean, d->p50, d->p95, d->p99, d->max);
+	}
+	fprintf(out, "\n");
+
+	fprintf(out, "%u processes in %u ticks on %u CPU%s, %.2f processes per 100 ticks\n",
+			s.nr_processes, ctx->ticks, ctx->nr_cpus, ctx->nr_cpus >= 2 ? "s" : "",
+			s.throughput);
+	fprintf(out, "CPU utilization %.1f%% (%u/%u), %u idle, %u blocked, %u switches, %u switch ticks\n",
+			s.utilization, s.nr_busy, s.capacity, ctx->__nr_idle, ctx->__nr_blocked,
+			ctx->__nr_switches, ctx->__nr_switch_ticks);
+	fprintf(out, "Jain's fairness index %.4f\n", s.fairness);
+	fprintf(out, "%u priority inversion%s, the longest for %u ticks, blocking chains up to %u\n",
+			ctx->__nr_inversions, ctx->__nr_inversions >= 2 ? "s" : "",
+			ctx->__max_inversion, ctx->__max_chain);
+	if (ctx->__nr_deadlocks) {
+		fprintf(out, "%u deadlock%s, %u process%s killed\n",
+				ctx->__nr_deadlocks, ctx->__nr_deadlocks != 1 ? "s" : "",
+				ctx->__nr_killed, ctx->__nr_killed != 1 ? "es" : "");
+	}
+
+	for (unsigned int i = 0; i < ctx->nr_resources; i++) {
+		if (!ctx->resources[i].__blocked) continue;
+		fprintf(out, "Resource %2u: blocked %u ticks\n", i, ctx->resources[i].__blocked);
+	}
+	for (int i = 0; i < NR_DEVICES; i++) {
+		struct sim_device *dev = ctx->devices + i;
+
+		if (!dev->nr_requests) continue;
+		fprintf(out, "Device %2d: %u requests, %.1f%% busy\n", i, dev->nr_requests,
+				ctx->ticks ? dev->nr_busy * 100.0 / ctx->ticks : 0.0);
+	}
+	fprintf(out, "\n");
+}
+
+static void csv_print(struct sim_context *ctx, FILE *out)
+{
+	struct summary s;
+	struct sim_record *rec;
+
+	__summarize(ctx, &s);
+
+	fprintf(out, "pid,job,arrival,first_run,finish,lifespan,turnaround,waiting,response,blocked,inversion,chain,io,killed\n");
+	list_for_each_entry(rec, &ctx->records, list) {
+		fprintf(out, "%d,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d\n",
+				rec->pid, rec->job, rec->arrival, rec->first_run, rec->finish,
+				rec->lifespan, __metric(rec, METRIC_TURNAROUND),
+				__metric(rec, METRIC_WAITING), __metric(rec, METRIC_RESPONSE),
+				rec->blocked, rec->inversion, rec->chain, rec->io, rec->killed);
+	}
+	fprintf(out, "\n");
+
+	fprintf(out, "metric,value\n");
+	fprintf(out, "scheduler,%s\n", ctx->sched->name);
+	fprintf(out, "processes,%u\n", s.nr_processes);
+	fprintf(out, "ticks,%u\n", ctx->ticks);
+	fprintf(out, "cpus,%u\n", ctx->nr_cpus);
+	fprintf(out, "throughput,%.4f\n", s.throughput);
+	fprintf(out, "utilization,%.4f\n", s.utilization);
+	fprintf(out, "idle,%u\n", ctx->__nr_idle);
+	fprintf(out, "blocked,%u\n", ctx->__nr_blocked);
+	fprintf(out, "switches,%u\n", ctx->__nr_switches);
+	fprintf(out, "switch_ticks,%u\n", ctx->__nr_switch_ticks);
+	fprintf(out, "fairness,%.4f\n", s.fairness);
+	fprintf(out, "inversions,%u\n", ctx->__nr_inversions);
+	fprintf(out, "inversion_max,%u\n", ctx->__max_inversion);
+	fprintf(out, "chain_max,%u\n", ctx->__max_chain);
+	fprintf(out, "deadlocks,%u\n", ctx->__nr_deadlocks);
+	fprintf(out, "killed,%u\n", ctx->__nr_killed);
+	for (int metric = 0; metric < NR_METRICS; metric++) {
+		struct distribution *d = s.dists + metric;
+		const char *name = __metric_names[metric];
+
+		fprintf(out, "%s_mean,%.4f\n", name, d->mean);
+		fprintf(out, "%s_p50,%u\n", name, d->p50);
+		fprintf(out, "%s_p95,%u\n", name, d->p95);
+		fprintf(out, "%s_p99,%u\n", name, d->p99);
+		fprintf(out, "%s_max,%u\n", name, d->max);
+	}
+	for (unsigned int i = 0; i < ctx->nr_resources; i++) {
+		if (!ctx->resources[i].__blocked) continue;
+		fprintf(out, "resource%u_blocked,%u\n", i, ctx->resources[i].__blocked);
+	}
+	for (int i = 0; i < NR_DEVICES; i++) {
+		if (!ctx->devices[i].nr_requests) continue;
+		fprintf(out, "device%d_requests,%u\n", i, ctx->devices[i].nr_requests);
+		fprintf(out, "device%d_busy,%u\n", i, ctx->devices[i].nr_busy);
+	}
+}
+
+static void json_print(struct sim_context *ctx, FILE *out)
+{
+	struct summary s;
+	struct sim_record *rec;
+	bool first = true;
+
+	__summarize(ctx, &s);
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"scheduler\": \"%s\",\n", ctx->sched->name);
+	fprintf(out, "  \"processes\": [");
+	list_for_each_entry(rec, &ctx->records, list) {
+		fprintf(out, "%s\n    {\"pid\": %d, \"job\": %u, \"arrival\": %u, "
+				"\"first_run\": %u, \"finish\": %u, \"lifespan\": %u, "
+				"\"turnaround\": %u, \"waiting\": %u, \"response\": %u, "
+				"\"blocked\": %u, \"inversion\": %u, \"chain\": %u, \"io\": %u, "
+				"\"killed\": %s}",
+				first ? "" : ",",
+				rec->pid, rec->job, rec->arrival, rec->first_run, rec->finish,
+				rec->lifespan, __metric(rec, METRIC_TURNAROUND),
+				__metric(rec, METRIC_WAITING), __metric(rec, METRIC_RESPONSE),
+				rec->blocked, rec->inversion, rec->chain, rec->io,
+				rec->killed ? "true" : "false");
+		first = false;
+	}
+	fprintf(out, "\n  ],\n");
+
+	fprintf(out, "  \"summary\": {\n");
+	fprintf(out, "    \"processes\": %u,\n", s.nr_processes);
+	fprintf(out, "    \"ticks\": %u,\n", ctx->ticks);
+	fprintf(out, "    \"cpus\": %u,\n", ctx->nr_cpus);
+	fprintf(out, "    \"throughput\": %.4f,\n", s.throughput);
+	fprintf(out, "    \"utilization\": %.4f,\n", s.utilization);
+	fprintf(out, "    \"idle\": %u,\n", ctx->__nr_idle);
+	fprintf(out, "    \"blocked\": %u,\n", ctx->__nr_blocked);
+	fprintf(out, "    \"switches\": %u,\n", ctx->__nr_switches);
+	fprintf(out, "    \"switch_ticks\": %u,\n", ctx->__nr_switch_ticks);
+	fprintf(out, "    \"fairness\": %.4f,\n", s.fairness);
+	fprintf(out, "    \"inversions\": %u,\n", ctx->__nr_inversions);
+	fprintf(out, "    \"inversion_max\": %u,\n", ctx->__max_inversion);
+	fprintf(out, "    \"chain_max\": %u,\n", ctx->__max_chain);
+	fprintf(out, "    \"deadlocks\": %u,\n", ctx->__nr_deadlocks);
+	fprintf(out, "    \"killed\": %u,\n", ctx->__nr_killed);
+	for (int metric = 0; metric < NR_METRICS; metric++) {
+		struct distribution *d = s.dists + metric;
+
+		fprintf(out, "    \"%s\": {\"mean\": %.4f, \"p50\": %u, \"p95\": %u, "
+				"\"p99\": %u, \"max\": %u},\n", __metric_names[metric],
+				d->mean, d->p50, d->p95, d->p99, d->max);
+	}
+
+	fprintf(out, "    \"resources\": {");
+	first = true;
+	for (unsigned int i = 0; i < ctx->nr_resources; i++) {
+		if (!ctx->resources[i].__blocked) continue;
+		fprintf(out, "%s\"%u\": %u", first ? "" : ", ", i, ctx->resources[i].__blocked);
+		first = false;
+	}
+	fprintf(out, "},\n");
+
+	fprintf(out, "    \"devices\": {");
+	first = true;
+	for (int i = 0; i < NR_DEVICES; i++) {
+		struct sim_device *dev = ctx->devices + i;
+
+		if (!dev->nr_requests) continue;
+		fprintf(out, "%s\"%d\": {\"requests\": %u, \"busy\": %u}",
+				first ? "" : ", ", i, dev->nr_requests, dev->nr_busy);
+		first = false;
+	}
+	fprintf(out, "}\n");
+	fprintf(out, "  }\n");
+	fprintf(out, "}\n");
+}
+
+static struct sim_report reports[] = {
+	{
+		.name = "table",
+		.print = table_print,
+	},
+	{
+		.name = "csv",
+		.print = csv_print,
+	},
+	{
+		.name = "json",
+		.print = json_print,
+	},
+};
+
+struct sim_report *sim_find_report(const char *name)
+{
+	for (int i = 0; i < sizeof(reports) / sizeof(*reports); i++) {
+		if (strcmp(reports[i].name, name) == 0) return reports + i;
+	}
+	return NULL;
+}
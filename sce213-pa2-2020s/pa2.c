@@ -18,39 +18,120 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "types.h"
 #include "list_head.h"
+#include "pqueue.h"
 
-/**
- * The process which is currently running
- */
 #include "process.h"
-extern struct process *current;
+#include "resource.h"
+#include "sched.h"
 
 /**
- * List head to hold the processes ready to run
+ * The simulation context holds the states of the simulator that schedulers
+ * can access; the process currently running (@ctx->current), the ready
+ * queue (@ctx->readyqueue), resources in the system (@ctx->resources),
+ * and monotonically increasing ticks (@ctx->ticks). See sim.h.
  */
-extern struct list_head readyqueue;
+#include "sim.h"
+
+
+/***********************************************************************
+ * Resource wait queues
+ *
+ * DESCRIPTION
+ *   A process waiting for a resource is on @waitqueue of the resource in
+ *   the requesting order, and on @waiters of the resource ordered by the
+ *   key given by the scheduler (e.g., the priority for the priority-based
+ *   schedulers), so that the waiter to wake up next is found in O(log n)
+ *   even with thousands of waiters on a hot resource. Waiters with the
+ *   same key are woken up in the requesting order, so the key of 0 makes
+ *   it FCFS. When the key of a waiter changes (e.g., its priority is
+ *   boosted by PIP), re-key it with __resource_requeue().
+ *
+ *   A resource of @units units takes that many exclusive holders at once,
+ *   or any number of shared holders but no exclusive one. The framework
+ *   records the holders on @holders of the resource when acquire()
+ *   returns true, and drops the current from them before calling
+ *   release(), so schedulers only decide who takes the resource next.
+ ***********************************************************************/
+static void __resource_wait(struct sim_context *ctx, int resource_id,
+		unsigned long long key)
+{
+	struct resource *r = ctx->resources + resource_id;
+	struct process *current = ctx->current;
 
+	current->status = PROCESS_WAIT;
+	current->waiting_on = resource_id;
+
+	list_add_tail(&current->list, &r->waitqueue);
+	pq_push(&r->waiters, &current->waiting, key);
+}
 
 /**
- * Resources in the system.
+ * Whether the current can take @resource_id now in the mode it asks for
+ * (@ctx->current->shared)
  */
-#include "resource.h"
-extern struct resource resources[NR_RESOURCES];
+static bool __resource_available(struct sim_context *ctx, int resource_id)
+{
+	struct resource *r = ctx->resources + resource_id;
 
+	if (ctx->current->shared) return !r->nr_exclusive;
+
+	return !r->nr_shared && r->nr_exclusive < r->units;
+}
 
 /**
- * Monotonically increasing ticks
+ * Wake up the waiters of @resource_id into the ready queue in the key order
+ * as long as the resource can take them with the holders left. That is, up
+ * to the free units for exclusive waiters, or a run of shared waiters
  */
-extern unsigned int ticks;
+static void __resource_wake(struct sim_context *ctx, int resource_id)
+{
+	struct resource *r = ctx->resources + resource_id;
+	unsigned int nr_exclusive = r->nr_exclusive;
+	unsigned int nr_shared = r->nr_shared;
+	struct pq_node *node;
+
+	while ((node = pq_peek(&r->waiters))) {
+		struct process *waiter = pq_entry(node, struct process, waiting);
+
+		if (waiter->shared) {
+			if (nr_exclusive) break;
+			nr_shared++;
+		} else {
+			if (nr_shared || nr_exclusive >= r->units) break;
+			nr_exclusive++;
+		}
+
+		pq_pop(&r->waiters);
+		assert(waiter->status == PROCESS_WAIT);
 
+		list_del_init(&waiter->list);
+		waiter->waiting_on = -1;
+		waiter->status = PROCESS_READY;
+		list_add_tail(&waiter->list, &ctx->readyqueue);
+	}
+}
 
 /**
- * Quiet mode. True if the program was started with -q option
+ * Return the waiter of @resource_id to wake up next without waking it up
  */
-extern bool quiet;
+static struct process *__resource_first_waiter(struct sim_context *ctx, int resource_id)
+{
+	struct pq_node *node = pq_peek(&ctx->resources[resource_id].waiters);
+
+	return node ? pq_entry(node, struct process, waiting) : NULL;
+}
+
+static void __resource_requeue(struct sim_context *ctx, struct process *p,
+		unsigned long long key)
+{
+	if (p->waiting_on < 0) return;
+
+	pq_update(&ctx->resources[p->waiting_on].waiters, &p->waiting, key);
+}
 
 
 /***********************************************************************
@@ -62,23 +143,20 @@ extern bool quiet;
  *   The current implementation serves the resource in the requesting order
  *   without considering the priority. See the comments in sched.h
  ***********************************************************************/
-bool fcfs_acquire(int resource_id)
+bool fcfs_acquire(struct sim_context *ctx, int resource_id)
 {
-	struct resource *r = resources + resource_id;
-
-	if (!r->owner) {
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
+	if (__resource_available(ctx, resource_id)) {
+		/* The holders leave room for the current. Take it! */
 		return true;
 	}
 
-	/* OK, this resource is taken by @r->owner. */
+	/* OK, this resource is taken by the holders. */
 
-	/* Update the current process state */
-	current->status = PROCESS_WAIT;
-
-	/* And append current to waitqueue */
-	list_add_tail(&current->list, &r->waitqueue);
+	/**
+	 * Update the current process state, and append current to the wait
+	 * queue. All waiters are keyed 0, so they are served in FCFS
+	 */
+	__resource_wait(ctx, resource_id, 0);
 
 	/**
 	 * And return false to indicate the resource is not available.
@@ -97,62 +175,34 @@ bool fcfs_acquire(int resource_id)
  *   The current implementation serves the resource in the requesting order
  *   without considering the priority. See the comments in sched.h
  ***********************************************************************/
-void fcfs_release(int resource_id)
+void fcfs_release(struct sim_context *ctx, int resource_id)
 {
-	struct resource *r = resources + resource_id;
-
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
-
-	/* Un-own this resource */
-	r->owner = NULL;
-
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue)) {
-		struct process *waiter =
-				list_first_entry(&r->waitqueue, struct process, list);
-
-		/**
-		 * Ensure the waiter  is in the wait status
-		 */
-		assert(waiter->status == PROCESS_WAIT);
-
-		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
-		 */
-		list_del_init(&waiter->list);
-
-		/* Update the process status */
-		waiter->status = PROCESS_READY;
-
-		/**
-		 * Put the waiter process into ready queue. The framework will
-		 * do the rest.
-		 */
-		list_add_tail(&waiter->list, &readyqueue);
-	}
+	/**
+	 * The framework has already taken the current out of the holders.
+	 * Let's wake up the waiters that came first, as many as the resource
+	 * can take now; one for a mutex. They are taken out of the waiting
+	 * queue with list_del_init() over list_del() to maintain the list
+	 * head tidy (otherwise, the framework will complain on the list head
+	 * when the process exits), and put into the ready queue. The
+	 * framework will do the rest.
+	 */
+	__resource_wake(ctx, resource_id);
 }
 
 
-
-#include "sched.h"
-
 /***********************************************************************
  * FIFO scheduler
  ***********************************************************************/
-static int fifo_initialize(void)
+static int fifo_initialize(struct sim_context *ctx)
 {
 	return 0;
 }
 
-static void fifo_finalize(void)
+static void fifo_finalize(struct sim_context *ctx)
 {
 }
 
-static struct process *fifo_schedule(void)
+static struct process *fifo_schedule(struct sim_context *ctx)
 {
 	struct process *next = NULL;
 
@@ -168,24 +218,24 @@ static struct process *fifo_schedule(void)
 	 * to the waitqueue of the corresponding resource. In this case just
 	 * pick the next as well.
 	 */
-	if (!current || current->status == PROCESS_WAIT) {
+	if (!ctx->current || ctx->current->status == PROCESS_WAIT) {
 		goto pick_next;
 	}
 
 	/* The current process has remaining lifetime. Schedule it again */
-	if (current->age < current->lifespan) {
-		return current;
+	if (ctx->current->age < ctx->current->lifespan) {
+		return ctx->current;
 	}
 
 pick_next:
 	/* Let's pick a new process to run next */
 
-	if (!list_empty(&readyqueue)) {
+	if (!list_empty(&ctx->readyqueue)) {
 		/**
 		 * If the ready queue is not empty, pick the first process
 		 * in the ready queue
 		 */
-		next = list_first_entry(&readyqueue, struct process, list);
+		next = list_first_entry(&ctx->readyqueue, struct process, list);
 		/**
 		 * Detach the process from the ready queue. Note we use list_del_init()
 		 * instead of list_del() to maintain the list head tidy. Otherwise,
@@ -198,6 +248,14 @@ pick_next:
 	return next;
 }
 
+/**
+ * Non-preemptive schedulers keep running current until it finishes
+ */
+static unsigned int nonpreemptive_slice(struct sim_context *ctx)
+{
+	return UINT_MAX;
+}
+
 struct scheduler fifo_scheduler = {
 	.name = "FIFO",
 	.acquire = fcfs_acquire,
@@ -205,99 +263,152 @@ struct scheduler fifo_scheduler = {
 	.initialize = fifo_initialize,
 	.finalize = fifo_finalize,
 	.schedule = fifo_schedule,
+	.slice = nonpreemptive_slice,
 };
 
 
+/***********************************************************************
+ * Heap-backed ready queue
+ *
+ * DESCRIPTION
+ *   The framework appends newly forked and woken-up processes to
+ *   @readyqueue. Schedulers that pick the next process by a key (SJF and
+ *   SRTF) pull them into @readypq (@ctx->sched_data) ordered by the key, so that
+ *   picking the next process costs O(log n) instead of scanning the whole
+ *   ready queue. Processes with the same key are picked in FIFO order.
+ ***********************************************************************/
+static int readypq_initialize(struct sim_context *ctx)
+{
+	struct pqueue *readypq = malloc(sizeof(*readypq));
+	if (!readypq) return -1;
+
+	pq_init(readypq);
+	ctx->sched_data = readypq;
+	return 0;
+}
+
+static void readypq_finalize(struct sim_context *ctx)
+{
+	pq_destroy(ctx->sched_data);
+	free(ctx->sched_data);
+	ctx->sched_data = NULL;
+}
+
+static void __readypq_pull(struct sim_context *ctx,
+		unsigned long long (*key)(struct process *))
+{
+	struct process *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &ctx->readyqueue, list) {
+		list_del_init(&p->list);
+		pq_push(ctx->sched_data, &p->pq, key(p));
+	}
+}
+
+static struct process *__readypq_pop(struct sim_context *ctx)
+{
+	struct pq_node *node = pq_pop(ctx->sched_data);
+
+	return node ? pq_entry(node, struct process, pq) : NULL;
+}
+
+/**
+ * Give away one of the later ones to another CPU
+ */
+static struct process *readypq_migrate(struct sim_context *ctx)
+{
+	struct pq_node *node;
+	struct process *p;
+
+	/* Not pulled yet. It is the latest one anyway */
+	if (!list_empty(&ctx->readyqueue)) {
+		p = list_last_entry(&ctx->readyqueue, struct process, list);
+		list_del_init(&p->list);
+		return p;
+	}
+
+	node = pq_last(ctx->sched_data);
+	if (!node) return NULL;
+
+	pq_remove(ctx->sched_data, node);
+	return pq_entry(node, struct process, pq);
+}
+
+/**
+ * Return true if @current can keep running without being preempted by
+ * the process on the top of @readypq. @current keeps running on a tie.
+ */
+static bool __readypq_keep_current(struct sim_context *ctx,
+		unsigned long long (*key)(struct process *))
+{
+	struct process *current = ctx->current;
+	struct pq_node *top;
+
+	if (!current || current->status == PROCESS_WAIT) return false;
+	if (current->age >= current->lifespan) return false;
+
+	top = pq_peek(ctx->sched_data);
+	if (!top) return true;
+
+	return top->key >= key(current);
+}
+
+
 /***********************************************************************
  * SJF scheduler
  ***********************************************************************/
-static struct process *sjf_schedule(void)
-{
-	struct process *sjfProc = list_first_entry(&readyqueue, struct process, list);
-	struct process *sjfSmallest = NULL;
-	unsigned int lsChk = 100;
-	if(current)
-		{
-			if(current->age < current->lifespan) //current가 끝날때까지 더돌아야함
-		 		return current;
-		}
+static unsigned long long sjf_key(struct process *p)
+{
+	return p->lifespan;
+}
 
-	if(!list_empty(&readyqueue)) //readyqueue 존재
-		{
-			list_for_each_entry(sjfProc, &readyqueue, list) //돌면서 제일작은애찾고 반환
-			{
-				if(sjfProc->lifespan < lsChk)
-				{
-                	lsChk = sjfProc->lifespan;
-					sjfSmallest = sjfProc;
-				}
-			}
-			list_del_init(&sjfSmallest->list);
-			return sjfSmallest;
-		}
-	else return NULL;
+static struct process *sjf_schedule(struct sim_context *ctx)
+{
+	__readypq_pull(ctx, sjf_key);
+
+	/* Non-preemptive. Keep running current until it finishes */
+	if (ctx->current && ctx->current->status != PROCESS_WAIT &&
+			ctx->current->age < ctx->current->lifespan) {
+		return ctx->current;
+	}
+
+	return __readypq_pop(ctx);
 }
 
 struct scheduler sjf_scheduler = {
 	.name = "Shortest-Job First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
-	.schedule = sjf_schedule, /* TODO: Assign sjf_schedule()
-								to this function pointer to activate
-								SJF in the system */
+	.initialize = readypq_initialize,
+	.finalize = readypq_finalize,
+	.migrate = readypq_migrate,
+	.schedule = sjf_schedule,
+	.slice = nonpreemptive_slice,
 };
 
 /***********************************************************************
  * SRTF scheduler
  ***********************************************************************/
-static struct process *srtf_schedule(void)
-{
-	struct process *srtfProc = list_first_entry(&readyqueue, struct process, list);
-	struct process *srtfSmallest = NULL;
-	
-	if(current)
-		{	
-			if(!list_empty(&readyqueue)) // current가 있고, 현재 readyqueue에 process존재
-			{
-				srtfSmallest = srtfProc;
-
-				if(current->age < current->lifespan)
-					list_add(&current->list,&readyqueue); //current가 아직 다 안 돌았으면, 맨 앞에 추가(같은 경우 돌던 애가 먼저 돌아야 함)
-
-				list_for_each_entry(srtfProc, &readyqueue, list) //readyqueue를 돌면서, 가장 작은 lifespan인 애를 smallest로 업데이트
-				{
-					if(srtfProc->lifespan < srtfSmallest->lifespan)
-					{
-            	    	srtfSmallest = srtfProc;
-					}
-				}
-				if(srtfSmallest->age <= srtfSmallest->lifespan) //current가 가장 lifespan이 작은데, 아직 다 돌지 못했으면 계속 돌려야 함
-		 		{
-					list_del_init(&srtfSmallest->list);
-					return srtfSmallest;
-				}
-				else return NULL;
-			}
-			else if(current->age < current->lifespan) //readyqueu에 아무것도 없음(마지막 프로세스)가 돌고있는 상태, 끝내줘야함
-		 		return current;
+static unsigned long long srtf_key(struct process *p)
+{
+	return p->lifespan - p->age;
+}
 
-			else return NULL;
-		}
+static struct process *srtf_schedule(struct sim_context *ctx)
+{
+	__readypq_pull(ctx, srtf_key);
 
-	else if(!list_empty(&readyqueue))
-	{
-		srtfSmallest = srtfProc;
-        list_for_each_entry(srtfProc, &readyqueue, list)//맨 처음 current를 생성
-			{
-				if(srtfProc->lifespan < srtfSmallest->lifespan)
-				{
-					srtfSmallest = srtfProc;
-				}
-			}
-			list_del_init(&srtfSmallest->list);
-			return srtfSmallest;
+	/* Preempt current only when a strictly shorter one is waiting */
+	if (__readypq_keep_current(ctx, srtf_key)) {
+		return ctx->current;
+	}
+
+	if (ctx->current && ctx->current->status != PROCESS_WAIT &&
+			ctx->current->age < ctx->current->lifespan) {
+		pq_push(ctx->sched_data, &ctx->current->pq, srtf_key(ctx->current));
 	}
-	else return NULL;
+
+	return __readypq_pop(ctx);
 }
 
 
@@ -305,252 +416,1612 @@ struct scheduler srtf_scheduler = {
 	.name = "Shortest Remaining Time First",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = readypq_initialize,
+	.finalize = readypq_finalize,
+	.migrate = readypq_migrate,
 	.schedule = srtf_schedule,
-	/* You need to check the newly created processes to implement SRTF.
-	 * Use @forked() callback to mark newly created processes */
-	/* Obviously, you should implement srtf_schedule() and attach it here */
+	/**
+	 * The remaining time of current only decreases, so it can be preempted
+	 * only by a new arrival, which stops skipping anyway.
+	 */
+	.slice = nonpreemptive_slice,
 };
 
 
 /***********************************************************************
  * Round-robin scheduler
+ *
+ * DESCRIPTION
+ *   Rotate the ready processes every @ctx->quantum ticks (-Q). The current
+ *   keeps running over its quantum while no one else is ready, and yields
+ *   at the next multiple of the quantum once someone shows up.
  ***********************************************************************/
-static struct process *rr_schedule(void)
-{
-	struct process *rrProc = list_first_entry(&readyqueue, struct process, list);
-	struct process *nrrProc = NULL;
-
-	if(!list_empty(&readyqueue)) 
-	{
-		if(current)
-		{
-			if(current->age < current->lifespan) //한번 돌았는데 안 끝났으면 readyqueue에 다시 추가, readyqueue 1번 애를 실행시킴
-			{
-				nrrProc = current;
-				list_add_tail(&nrrProc->list,&readyqueue);
-				list_del_init(&rrProc->list);
-				return rrProc;
-			}
-			else //다 돌았으면 바로 다음애 반환
-			{
-				list_del_init(&rrProc->list);
-				return rrProc;
-			}
-		}		
-		else //맨 처음 current 생성 
-		{
-			list_del_init(&rrProc->list);
-			return rrProc;
-		}
-	}
-	else if(current->age < current->lifespan) //내가마지막
-		{
+struct rr_rq {
+	unsigned int picked_at;		/* Age of the current when it was picked */
+};
+
+static int rr_initialize(struct sim_context *ctx)
+{
+	struct rr_rq *rq = malloc(sizeof(*rq));
+	if (!rq) return -1;
+
+	rq->picked_at = 0;
+	ctx->sched_data = rq;
+	return 0;
+}
+
+static void rr_finalize(struct sim_context *ctx)
+{
+	free(ctx->sched_data);
+	ctx->sched_data = NULL;
+}
+
+static struct process *rr_schedule(struct sim_context *ctx)
+{
+	struct rr_rq *rq = ctx->sched_data;
+	struct process *current = ctx->current;
+	struct process *next;
+
+	if (current && current->status != PROCESS_WAIT &&
+			current->age < current->lifespan) {
+		unsigned int ran = current->age - rq->picked_at;
+
+		/* Keep running until the quantum expires */
+		if (list_empty(&ctx->readyqueue) || !ran || ran % ctx->quantum) {
 			return current;
 		}
-	else return NULL;
+		list_add_tail(&current->list, &ctx->readyqueue);
+	}
+
+	if (list_empty(&ctx->readyqueue)) return NULL;
+
+	next = list_first_entry(&ctx->readyqueue, struct process, list);
+	list_del_init(&next->list);
+	rq->picked_at = next->age;
+
+	return next;
+}
+
+static unsigned int rr_slice(struct sim_context *ctx)
+{
+	struct rr_rq *rq = ctx->sched_data;
+	unsigned int ran = ctx->current->age - rq->picked_at;
+
+	/* Current is the only one to run */
+	if (list_empty(&ctx->readyqueue)) return UINT_MAX;
+
+	/* Until the end of the quantum */
+	if (!ran) return ctx->quantum;
+	return ran % ctx->quantum ? ctx->quantum - ran % ctx->quantum : 0;
 }
 
 struct scheduler rr_scheduler = {
 	.name = "Round-Robin",
 	.acquire = fcfs_acquire, /* Use the default FCFS acquire() */
 	.release = fcfs_release, /* Use the default FCFS release() */
+	.initialize = rr_initialize,
+	.finalize = rr_finalize,
 	.schedule = rr_schedule,
-	/* Obviously, you should implement rr_schedule() and attach it here */
+	.slice = rr_slice,
 };
 
 
 /***********************************************************************
- * Priority scheduler
+ * O(1) priority run queue
+ *
+ * DESCRIPTION
+ *   Like the O(1) scheduler of Linux, keep one run list per priority level
+ *   and a bitmap of non-empty levels. Picking the highest priority process
+ *   is a find-first-set over the bitmap, and re-prioritizing a queued
+ *   process (e.g., boosting by PIP) just moves it to another run list.
+ *   Priority levels span from 0 to MAX_PRIO inclusive since PCP boosts
+ *   the priority to MAX_PRIO, so the bitmap takes two 64-bit words.
  ***********************************************************************/
-static struct process *prio_schedule(void)
-{
-    struct process *prioProc = list_first_entry(&readyqueue, struct process, list);
-	struct process *highest = NULL;
-
-	if(current && current->status != PROCESS_WAIT) //current 존재, 기다리는중이면 다음애 반환
-    	{
-			if(!list_empty(&readyqueue)) //readyqueue에 다음 프로세스 존재
-			{
-				highest = prioProc; //highest는 일단 처음거
-				
-				if(current->age < current->lifespan) //아직 current가 돌 필요가 있으면
-					list_add_tail(&current->list,&readyqueue); //list에 맨 뒤에 다시 추가(같은 경우 얘는 나중에 다시 돌아야 함)
-				
-				list_for_each_entry(prioProc, &readyqueue, list) //readyqueue를 보면서 prio비교한 후 제일 높은 애를 highest로 갱신
-				{
-					if(prioProc->prio > highest->prio) //prio같은경우 여기 안들어가짐, 번갈아가면서 돔
-					{
-						highest = prioProc;
-					}
-				}
-				if(highest->age <= highest->lifespan) //highest가 더 돌아야 한다면 highest 반환
-					{
-						list_del_init(&highest->list);
-						return highest;
-					}
-				else return NULL;
-			}
-			else if(current->age < current->lifespan) //내가 마지막인데 더돌아야됨
-					return current;
-				
-				else return NULL;
-		}
-	else if(!list_empty(&readyqueue))
-	    {
-			highest = prioProc;
-			list_for_each_entry(prioProc, &readyqueue, list)
-		    {
-		        if(prioProc->prio > highest->prio)
-				{
-					highest = prioProc;
-				}
-		    }
-			list_del_init(&highest->list);
-			return highest;
-		}
-	else return NULL;
-}
+#define NR_PRIO_LEVELS		(MAX_PRIO + 1)
+#define PRIO_BITMAP_WORDS	((NR_PRIO_LEVELS + 63) / 64)
 
-struct scheduler prio_scheduler = {
-	.name = "Priority",
-	.acquire = fcfs_acquire,
-	.release = fcfs_release,
-    .schedule = prio_schedule,
-	/**
-	 * Implement your own acqure/release function to make priority
-	 * scheduler correct.
-	 */
-	/* Implement your own prio_schedule() and attach it here */
+struct prio_rq {
+	struct list_head lists[NR_PRIO_LEVELS];
+	unsigned long long bitmap[PRIO_BITMAP_WORDS];
 };
 
-
-/***********************************************************************
- * Priority scheduler with priority ceiling protocol
- ***********************************************************************/
-bool pcp_acquire(int resource_id)
+static int prio_initialize(struct sim_context *ctx)
 {
-	struct resource *r = resources + resource_id;
+	struct prio_rq *rq = malloc(sizeof(*rq));
+	if (!rq) return -1;
 
-	if (!r->owner) {
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
-		current->prio = MAX_PRIO;
-		return true;
+	for (int i = 0; i < NR_PRIO_LEVELS; i++) {
+		INIT_LIST_HEAD(rq->lists + i);
+	}
+	for (int i = 0; i < PRIO_BITMAP_WORDS; i++) {
+		rq->bitmap[i] = 0;
 	}
 
-	/* OK, this resource is taken by @r->owner. */
+	ctx->sched_data = rq;
+	return 0;
+}
 
-	/* Update the current process state */
-	current->status = PROCESS_WAIT;
+static void prio_finalize(struct sim_context *ctx)
+{
+	free(ctx->sched_data);
+	ctx->sched_data = NULL;
+}
 
-	/* And append current to waitqueue */
-	list_add_tail(&current->list, &r->waitqueue);
+static void __prio_rq_enqueue(struct prio_rq *rq, struct process *p)
+{
+	assert(p->prio <= MAX_PRIO);
 
-	/**
-	 * And return false to indicate the resource is not available.
-	 * The scheduler framework will soon call schedule() function to
-	 * schedule out current and to pick the next process to run.
-	 */
-	return false;
+	list_add_tail(&p->list, rq->lists + p->prio);
+	rq->bitmap[p->prio / 64] |= 1ULL << (p->prio % 64);
 }
 
-void prio_release(int resource_id)
+static void __prio_rq_dequeue(struct prio_rq *rq, struct process *p)
 {
-	struct resource *r = resources + resource_id;
+	list_del_init(&p->list);
 
-	/* Ensure that the owner process is releasing the resource */
-	assert(r->owner == current);
+	if (list_empty(rq->lists + p->prio)) {
+		rq->bitmap[p->prio / 64] &= ~(1ULL << (p->prio % 64));
+	}
+}
 
-	r->owner->prio = r->owner->prio_orig;
+/**
+ * Return the highest priority level having ready processes, or -1 if
+ * the run queue is empty.
+ */
+static int __prio_rq_highest(struct prio_rq *rq)
+{
+	for (int i = PRIO_BITMAP_WORDS - 1; i >= 0; i--) {
+		if (rq->bitmap[i]) {
+			return i * 64 + 63 - __builtin_clzll(rq->bitmap[i]);
+		}
+	}
+	return -1;
+}
 
-	/* Un-own this resource */
-	r->owner = NULL;
+static void __prio_rq_pull_from(struct prio_rq *rq, struct list_head *readyqueue)
+{
+	struct process *p, *tmp;
 
-	/* Let's wake up ONE waiter (if exists) that came first */
-	if (!list_empty(&r->waitqueue)) {
-		struct process *waiter =
-				list_first_entry(&r->waitqueue, struct process, list);
-		struct process *prioChk = NULL;
-			list_for_each_entry(prioChk, &r->waitqueue, list)
-			{
-				if(waiter->prio < prioChk->prio)
-				{
-					waiter = prioChk;
-				}
-			}			
-		/**
-		 * Ensure the waiter  is in the wait status
-		 */
-		assert(waiter->status == PROCESS_WAIT);
+	list_for_each_entry_safe(p, tmp, readyqueue, list) {
+		list_del_init(&p->list);
+		__prio_rq_enqueue(rq, p);
+	}
+}
 
-		/**
-		 * Take out the waiter from the waiting queue. Note we use
-		 * list_del_init() over list_del() to maintain the list head tidy
-		 * (otherwise, the framework will complain on the list head
-		 * when the process exits).
-		 */
-		list_del_init(&waiter->list);
+static void __prio_rq_pull(struct sim_context *ctx)
+{
+	__prio_rq_pull_from(ctx->sched_data, &ctx->readyqueue);
+}
 
-		/* Update the process status */
-		waiter->status = PROCESS_READY;
+/**
+ * Key of @p among the waiters of a resource; the higher priority, the earlier
+ */
+static unsigned long long __prio_wait_key(struct process *p)
+{
+	return MAX_PRIO - p->prio;
+}
 
-		/**
-		 * Put the waiter process into ready queue. The framework will
-		 * do the rest.
-		 */
-		list_add_tail(&waiter->list, &readyqueue);
+/**
+ * Change the effective priority of @p, moving it to the corresponding
+ * run list if it is waiting in the run queue, or re-keying it among the
+ * waiters if it is waiting for a resource. @p may be queued on another
+ * CPU in the multi-processor simulation.
+ */
+static void __prio_rq_set_prio(struct sim_context *ctx, struct process *p,
+		unsigned int prio)
+{
+	struct prio_rq *rq = sim_sched_data_of(ctx, p->cpu);
+
+	/* After pulling, a ready process on a list is on one of the run lists */
+	__prio_rq_pull_from(rq, sim_readyqueue_of(ctx, p->cpu));
+
+	if (p->status == PROCESS_READY && !list_empty(&p->list)) {
+		__prio_rq_dequeue(rq, p);
+		p->prio = prio;
+		__prio_rq_enqueue(rq, p);
+	} else {
+		p->prio = prio;
+		__resource_requeue(ctx, p, __prio_wait_key(p));
 	}
 }
 
-struct scheduler pcp_scheduler = {
-	.name = "Priority + Priority Ceiling Protocol",
-	.acquire = pcp_acquire,
-	.release = prio_release,
-    .schedule = prio_schedule,
-	/**
-	 * Implement your own acqure/release function too to make priority
-	 * scheduler correct.
-	 */
-};
-
 
 /***********************************************************************
- * Priority scheduler with priority inheritance protocol
+ * Priority scheduler
  ***********************************************************************/
-bool pip_acquire(int resource_id)
+static struct process *prio_schedule(struct sim_context *ctx)
 {
-	struct resource *r = resources + resource_id;
-	
-	if (!r->owner) {
-		/* This resource is not owned by any one. Take it! */
-		r->owner = current;
-		return true;
+	struct process *current = ctx->current;
+	struct prio_rq *rq = ctx->sched_data;
+	struct process *next;
+	int highest;
+
+	__prio_rq_pull(ctx);
+
+	highest = __prio_rq_highest(rq);
+
+	if (current && current->status != PROCESS_WAIT &&
+			current->age < current->lifespan) {
+		/* Processes with the same priority are switched on each tick */
+		if (highest < (int)current->prio) return current;
+
+		__prio_rq_enqueue(rq, current);
+		highest = __prio_rq_highest(rq);
 	}
 
-	/* OK, this resource is taken by @r->owner. */
+	if (highest < 0) return NULL;
 
-	/* Update the current process state */
-	current->status = PROCESS_WAIT;
-	 if(r->owner->prio < current->prio)
-		r->owner->prio = current->prio;
+	next = list_first_entry(rq->lists + highest, struct process, list);
+	__prio_rq_dequeue(rq, next);
 
-	/* And append current to waitqueue */
-	list_add_tail(&current->list, &r->waitqueue);
+	return next;
+}
 
-	/**
-	 * And return false to indicate the resource is not available.
-	 * The scheduler framework will soon call schedule() function to
-	 * schedule out current and to pick the next process to run.
-	 */
-	return false;
+/**
+ * Give away the last one of the lowest priority to another CPU
+ */
+static struct process *prio_migrate(struct sim_context *ctx)
+{
+	struct prio_rq *rq = ctx->sched_data;
+	struct process *p;
+
+	__prio_rq_pull(ctx);
+
+	for (int i = 0; i < PRIO_BITMAP_WORDS; i++) {
+		if (!rq->bitmap[i]) continue;
+
+		p = list_last_entry(rq->lists + i * 64 + __builtin_ctzll(rq->bitmap[i]),
+				struct process, list);
+		__prio_rq_dequeue(rq, p);
+		return p;
+	}
+	return NULL;
 }
 
-struct scheduler pip_scheduler = {
-	.name = "Priority + Priority Inheritance Protocol",
-	.acquire = pip_acquire,
+static unsigned int prio_slice(struct sim_context *ctx)
+{
+	__prio_rq_pull(ctx);
+
+	/* Keep running until the same or higher priority one shows up */
+	return __prio_rq_highest(ctx->sched_data) < (int)ctx->current->prio ?
+			UINT_MAX : 0;
+}
+
+/**
+ * Wait in the priority order, so that the release wakes up the waiter with
+ * the highest priority, which came first on a tie
+ */
+static bool prio_acquire(struct sim_context *ctx, int resource_id)
+{
+	if (__resource_available(ctx, resource_id)) return true;
+
+	__resource_wait(ctx, resource_id, __prio_wait_key(ctx->current));
+	return false;
+}
+
+struct scheduler prio_scheduler = {
+	.name = "Priority",
+	.acquire = prio_acquire,
+	.release = fcfs_release,
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.schedule = prio_schedule,
+	.slice = prio_slice,
+	.migrate = prio_migrate,
+	/**
+	 * Implement your own acqure/release function to make priority
+	 * scheduler correct.
+	 */
+	/* Implement your own prio_schedule() and attach it here */
+};
+
+
+/***********************************************************************
+ * Priority scheduler with priority ceiling protocol
+ ***********************************************************************/
+bool pcp_acquire(struct sim_context *ctx, int resource_id)
+{
+	if (__resource_available(ctx, resource_id)) {
+		/* The holders leave room for the current. Take it! */
+		ctx->current->prio = MAX_PRIO;
+		return true;
+	}
+
+	/* OK, this resource is taken by the holders. Wait in the priority order */
+	__resource_wait(ctx, resource_id, __prio_wait_key(ctx->current));
+
+	/**
+	 * And return false to indicate the resource is not available.
+	 * The scheduler framework will soon call schedule() function to
+	 * schedule out current and to pick the next process to run.
+	 */
+	return false;
+}
+
+void prio_release(struct sim_context *ctx, int resource_id)
+{
+	ctx->current->prio = ctx->current->prio_orig;
+
+	/**
+	 * Wake up the waiters with the highest priority, which came first on
+	 * a tie, as many as the resource can take now
+	 */
+	__resource_wake(ctx, resource_id);
+}
+
+struct scheduler pcp_scheduler = {
+	.name = "Priority + Priority Ceiling Protocol",
+	.acquire = pcp_acquire,
 	.release = prio_release,
-    .schedule = prio_schedule,
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.schedule = prio_schedule,
+	.slice = prio_slice,
+	.migrate = prio_migrate,
+	/**
+	 * Implement your own acqure/release function too to make priority
+	 * scheduler correct.
+	 */
+};
+
+
+/***********************************************************************
+ * Priority scheduler with priority inheritance protocol
+ *
+ * DESCRIPTION
+ *   The holders of a resource run at the highest priority of their own
+ *   and the waiters of the resources they hold; a waiter for a shared
+ *   resource lends its priority to all the shared holders. The
+ *   inheritance is transitive; when A waits for B which waits for C, C
+ *   inherits the priority of A through B. On release, the priority is
+ *   recomputed from the waiters of the resources still held, so the ones
+ *   inherited through them are kept.
+ ***********************************************************************/
+
+/**
+ * Raise the priority of the holders of @resource_id, and of the ones
+ * blocking them in turn, to @prio. The walk cannot run into a cycle because
+ * the holders are raised on the way
+ */
+static void __pip_propagate(struct sim_context *ctx, int resource_id,
+		unsigned int prio)
+{
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &ctx->resources[resource_id].holders, holders) {
+		struct process *holder = hold->process;
+
+		if (holder->prio >= prio) continue;
+
+		__prio_rq_set_prio(ctx, holder, prio);
+
+		if (holder->waiting_on >= 0) {
+			__pip_propagate(ctx, holder->waiting_on, prio);
+		}
+	}
+}
+
+bool pip_acquire(struct sim_context *ctx, int resource_id)
+{
+	struct process *waiter;
+
+	if (__resource_available(ctx, resource_id)) {
+		/* The holders leave room for the current. Take it! */
+
+		/* And inherit from the waiters left behind */
+		waiter = __resource_first_waiter(ctx, resource_id);
+		if (waiter && waiter->prio > ctx->current->prio) {
+			ctx->current->prio = waiter->prio;
+		}
+		return true;
+	}
+
+	/* OK, this resource is taken by the holders. Wait in the priority order */
+	__resource_wait(ctx, resource_id, __prio_wait_key(ctx->current));
+
+	__pip_propagate(ctx, resource_id, ctx->current->prio);
+
+	/**
+	 * And return false to indicate the resource is not available.
+	 * The scheduler framework will soon call schedule() function to
+	 * schedule out current and to pick the next process to run.
+	 */
+	return false;
+}
+
+/**
+ * The priority that @p inherits through the resources it holds, from the
+ * waiter of the highest priority of each
+ */
+static unsigned int __pip_inherited_prio(struct sim_context *ctx, struct process *p)
+{
+	unsigned int prio = p->prio_orig;
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &p->holding, holding) {
+		struct process *waiter = __resource_first_waiter(ctx, hold->resource_id);
+
+		if (waiter && waiter->prio > prio) prio = waiter->prio;
+	}
+	return prio;
+}
+
+void pip_release(struct sim_context *ctx, int resource_id)
+{
+	__resource_wake(ctx, resource_id);
+
+	/**
+	 * Keep the priority inherited through the resources still held. The
+	 * current is on no queue, so just set it. Pulling the ready queue
+	 * here would hide the waiter woken up from the framework
+	 */
+	ctx->current->prio = __pip_inherited_prio(ctx, ctx->current);
+}
+
+/**
+ * Lower the holders of @resource_id, and the ones they were boosting in
+ * turn, to what is left to inherit after a waiter has given up
+ */
+static void pip_cancel(struct sim_context *ctx, int resource_id)
+{
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &ctx->resources[resource_id].holders, holders) {
+		struct process *holder = hold->process;
+		unsigned int prio = __pip_inherited_prio(ctx, holder);
+
+		if (prio >= holder->prio) continue;
+
+		__prio_rq_set_prio(ctx, holder, prio);
+
+		if (holder->waiting_on >= 0) pip_cancel(ctx, holder->waiting_on);
+	}
+}
+
+struct scheduler pip_scheduler = {
+	.name = "Priority + Priority Inheritance Protocol",
+	.acquire = pip_acquire,
+	.release = pip_release,
+	.cancel = pip_cancel,
+	.initialize = prio_initialize,
+	.finalize = prio_finalize,
+	.schedule = prio_schedule,
+	.slice = prio_slice,
+	.migrate = prio_migrate,
 	/**
 	 * Ditto
 	 */
 };
+
+
+/***********************************************************************
+ * CFS-like fair scheduler
+ *
+ * DESCRIPTION
+ *   Like the Completely Fair Scheduler of Linux, a process accumulates
+ *   virtual runtime (vruntime) while it runs, at a rate inversely
+ *   proportional to its weight, and the process with the smallest vruntime
+ *   runs next. The weight grows by 1.25x per priority level, so a process
+ *   gets about 1.25x more CPU time than the one with one lower priority.
+ *   Ready processes are kept in a pqueue keyed by vruntime instead of the
+ *   red-black tree of Linux; both give the leftmost process in O(log n).
+ *
+ *   Every ready process is given a time slice in each scheduling period,
+ *   which is the latency target but is stretched to keep each slice longer
+ *   than the minimum granularity. Tune them with -o (in ticks);
+ *
+ *   latency             Scheduling period (default: 8)
+ *   min_granularity     Minimum time slice (default: 1)
+ *   wakeup_granularity  How much less vruntime a forked or woken-up process
+ *                       should have to preempt the current (default: 1)
+ ***********************************************************************/
+#define CFS_NICE_0_WEIGHT	1024ULL
+#define CFS_VRUNTIME_SHIFT	30	/* vruntime per tick at CFS_NICE_0_WEIGHT */
+
+struct cfs_rq {
+	struct pqueue timeline;		/* Ready processes ordered by vruntime */
+	unsigned long long min_vruntime;	/* Monotonically increasing */
+	unsigned long long load;	/* Total weight of runnable processes */
+	unsigned int nr_running;	/* # of runnable processes including current */
+
+	unsigned int latency;
+	unsigned int min_granularity;
+	unsigned int wakeup_granularity;
+};
+
+struct cfs_entity {
+	unsigned long long vruntime;
+	unsigned long long weight;
+
+	struct cfs_rq *rq;		/* The rq that counts the process as runnable */
+
+	unsigned int exec_age;	/* Age when vruntime was updated last */
+	unsigned int pick_age;	/* Age when the process was picked to run */
+
+	bool relative;			/* @vruntime is relative to min_vruntime */
+	bool forked;			/* Just forked and is not placed yet */
+	bool sleeping;			/* Just woken up and is not placed yet */
+};
+
+static unsigned long long __cfs_weight(unsigned int prio)
+{
+	unsigned long long weight = CFS_NICE_0_WEIGHT;
+
+	while (prio--) weight = weight * 5 / 4;
+
+	return weight;
+}
+
+/**
+ * vruntime to accumulate by running @ticks with @weight
+ */
+static unsigned long long __cfs_vdelta(unsigned long long ticks, unsigned long long weight)
+{
+	return (CFS_NICE_0_WEIGHT << CFS_VRUNTIME_SHIFT) / weight * ticks;
+}
+
+/**
+ * Time slice of @se in the current scheduling period
+ */
+static unsigned int __cfs_slice(struct cfs_rq *rq, struct cfs_entity *se)
+{
+	unsigned long long period = rq->latency;
+	unsigned long long slice;
+
+	if (rq->nr_running > rq->latency / rq->min_granularity) {
+		period = (unsigned long long)rq->nr_running * rq->min_granularity;
+	}
+
+	slice = period * se->weight / rq->load;
+
+	return slice ? slice : 1;
+}
+
+static void __cfs_account(struct cfs_rq *rq, struct cfs_entity *se)
+{
+	se->rq = rq;
+	rq->load += se->weight;
+	rq->nr_running++;
+}
+
+static void __cfs_unaccount(struct cfs_entity *se)
+{
+	se->rq->load -= se->weight;
+	se->rq->nr_running--;
+	se->rq = NULL;
+}
+
+/**
+ * Take @se out of its rq, keeping the vruntime relative to the rq so that
+ * it can be placed on any CPU later
+ */
+static void __cfs_detach(struct cfs_entity *se)
+{
+	se->vruntime -= se->rq->min_vruntime;
+	se->relative = true;
+	__cfs_unaccount(se);
+}
+
+static void __cfs_update_curr(struct process *p)
+{
+	struct cfs_entity *se = p->sched_data;
+
+	se->vruntime += __cfs_vdelta(p->age - se->exec_age, se->weight);
+	se->exec_age = p->age;
+}
+
+static void __cfs_update_min_vruntime(struct cfs_rq *rq, struct process *current)
+{
+	struct pq_node *leftmost = pq_peek(&rq->timeline);
+	unsigned long long vruntime;
+
+	if (current) {
+		vruntime = ((struct cfs_entity *)current->sched_data)->vruntime;
+		if (leftmost && leftmost->key < vruntime) vruntime = leftmost->key;
+	} else if (leftmost) {
+		vruntime = leftmost->key;
+	} else {
+		return;
+	}
+
+	if (vruntime > rq->min_vruntime) rq->min_vruntime = vruntime;
+}
+
+/**
+ * Place @p on the timeline of @rq
+ */
+static void __cfs_enqueue(struct cfs_rq *rq, struct process *p)
+{
+	struct cfs_entity *se = p->sched_data;
+
+	/* Blocked on another CPU and is woken up before the CPU noticed it */
+	if (se->rq) {
+		__cfs_detach(se);
+		se->sleeping = true;
+	}
+
+	if (se->relative) {
+		se->vruntime += rq->min_vruntime;
+		se->relative = false;
+	}
+	__cfs_account(rq, se);
+
+	if (se->forked) {
+		/* Start debit. Do not let a new process run ahead of the others */
+		se->vruntime += __cfs_vdelta(__cfs_slice(rq, se), se->weight);
+	} else if (se->sleeping) {
+		/* Sleeper credit, but not enough to monopolize the CPU */
+		unsigned long long thresh = __cfs_vdelta(rq->latency, CFS_NICE_0_WEIGHT) / 2;
+		unsigned long long floor = rq->min_vruntime > thresh ?
+				rq->min_vruntime - thresh : 0;
+
+		if (se->vruntime < floor) se->vruntime = floor;
+	}
+	se->forked = se->sleeping = false;
+
+	pq_push(&rq->timeline, &p->pq, se->vruntime);
+}
+
+static int cfs_initialize(struct sim_context *ctx)
+{
+	struct cfs_rq *rq = malloc(sizeof(*rq));
+	if (!rq) return -1;
+
+	pq_init(&rq->timeline);
+	rq->min_vruntime = 0;
+	rq->load = 0;
+	rq->nr_running = 0;
+
+	rq->latency = sim_option(ctx, "latency", 8);
+	rq->min_granularity = sim_option(ctx, "min_granularity", 1);
+	rq->wakeup_granularity = sim_option(ctx, "wakeup_granularity", 1);
+
+	ctx->sched_data = rq;
+
+	if (!rq->latency || !rq->min_granularity) {
+		fprintf(stderr, "latency and min_granularity should be positive\n");
+		return -1;
+	}
+	return 0;
+}
+
+static void cfs_finalize(struct sim_context *ctx)
+{
+	struct cfs_rq *rq = ctx->sched_data;
+
+	if (!rq) return;
+
+	pq_destroy(&rq->timeline);
+	free(rq);
+	ctx->sched_data = NULL;
+}
+
+static void cfs_forked(struct sim_context *ctx, struct process *p)
+{
+	struct cfs_entity *se = malloc(sizeof(*se));
+
+	assert(se);
+
+	se->vruntime = 0;
+	se->weight = __cfs_weight(p->prio);
+	se->rq = NULL;
+	se->exec_age = se->pick_age = p->age;
+	se->relative = true;
+	se->forked = true;
+	se->sleeping = false;
+
+	p->sched_data = se;
+}
+
+static void cfs_exiting(struct sim_context *ctx, struct process *p)
+{
+	struct cfs_entity *se = p->sched_data;
+
+	if (se->rq) __cfs_unaccount(se);
+
+	free(se);
+	p->sched_data = NULL;
+}
+
+static struct process *cfs_schedule(struct sim_context *ctx)
+{
+	struct cfs_rq *rq = ctx->sched_data;
+	struct process *current = ctx->current;
+	struct process *p, *tmp;
+	struct pq_node *leftmost;
+	struct cfs_entity *se;
+	bool resched = false;
+
+	if (current) {
+		se = current->sched_data;
+		__cfs_update_curr(current);
+
+		/* Keep min_vruntime up to date before placing or detaching */
+		__cfs_update_min_vruntime(rq, current);
+
+		if (current->status == PROCESS_WAIT) {
+			__cfs_detach(se);
+			se->sleeping = true;
+			current = NULL;
+		} else if (current->age >= current->lifespan) {
+			__cfs_unaccount(se);
+			current = NULL;
+		}
+	}
+
+	/* Place the processes forked, woken up, or migrated */
+	list_for_each_entry_safe(p, tmp, &ctx->readyqueue, list) {
+		list_del_init(&p->list);
+		__cfs_enqueue(rq, p);
+
+		/* Preempt the current if the newcomer is far behind */
+		if (current) {
+			se = p->sched_data;
+			if (se->vruntime + __cfs_vdelta(rq->wakeup_granularity, se->weight) <
+					((struct cfs_entity *)current->sched_data)->vruntime) {
+				resched = true;
+			}
+		}
+	}
+
+	__cfs_update_min_vruntime(rq, current);
+
+	if (current) {
+		se = current->sched_data;
+
+		/* Used up the slice in this period while others are waiting */
+		if (!pq_empty(&rq->timeline) &&
+				current->age - se->pick_age >= __cfs_slice(rq, se)) {
+			resched = true;
+		}
+
+		if (!resched) return current;
+
+		pq_push(&rq->timeline, &current->pq, se->vruntime);
+	}
+
+	leftmost = pq_pop(&rq->timeline);
+	if (!leftmost) return NULL;
+
+	p = pq_entry(leftmost, struct process, pq);
+	se = p->sched_data;
+	se->exec_age = se->pick_age = p->age;
+
+	return p;
+}
+
+static unsigned int cfs_slice(struct sim_context *ctx)
+{
+	struct cfs_rq *rq = ctx->sched_data;
+	struct cfs_entity *se = ctx->current->sched_data;
+	unsigned int ran = ctx->current->age - se->pick_age;
+	unsigned int slice;
+
+	/* Newcomers might preempt the current */
+	if (!list_empty(&ctx->readyqueue)) return 0;
+
+	/* Nothing to switch to */
+	if (pq_empty(&rq->timeline)) return UINT_MAX;
+
+	slice = __cfs_slice(rq, se);
+	return ran < slice ? slice - ran : 0;
+}
+
+static struct process *cfs_migrate(struct sim_context *ctx)
+{
+	struct cfs_rq *rq = ctx->sched_data;
+	struct pq_node *node;
+	struct process *p;
+
+	/* Not placed yet. Carry it as is */
+	if (!list_empty(&ctx->readyqueue)) {
+		p = list_last_entry(&ctx->readyqueue, struct process, list);
+		list_del_init(&p->list);
+		return p;
+	}
+
+	node = pq_last(&rq->timeline);
+	if (!node) return NULL;
+
+	pq_remove(&rq->timeline, node);
+	p = pq_entry(node, struct process, pq);
+	__cfs_detach(p->sched_data);
+
+	return p;
+}
+
+struct scheduler cfs_scheduler = {
+	.name = "Completely Fair",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.initialize = cfs_initialize,
+	.finalize = cfs_finalize,
+	.forked = cfs_forked,
+	.exiting = cfs_exiting,
+	.schedule = cfs_schedule,
+	.slice = cfs_slice,
+	.migrate = cfs_migrate,
+};
+
+
+/***********************************************************************
+ * Multi-level feedback queue scheduler
+ *
+ * DESCRIPTION
+ *   Processes start at the top level (level 0) and the one at the highest
+ *   level runs first. Processes at the same level run in round-robin with
+ *   the quantum of the level. A process that used up the quantum of its
+ *   level, whether at once or across blocking, is demoted one level down.
+ *   Every boost interval, all the processes are moved back to the top so
+ *   that low-level ones do not starve. Tune it with -o;
+ *
+ *   levels     Number of levels up to MLFQ_MAX_LEVELS (default: 3)
+ *   quantum    Quantum of the top level, which doubles level by level
+ *              (default: -Q of the command line)
+ *   quantumN   Quantum of level N, overriding the one from @quantum
+ *   boost      Boost interval in ticks. 0 to disable (default: 100)
+ ***********************************************************************/
+#define MLFQ_MAX_LEVELS		64
+
+struct mlfq_rq {
+	struct list_head lists[MLFQ_MAX_LEVELS];
+	unsigned long long bitmap;	/* Levels having ready processes */
+	unsigned int epoch;			/* Boost epoch of the processes in @lists */
+
+	unsigned int nr_levels;
+	unsigned int quanta[MLFQ_MAX_LEVELS];
+	unsigned int boost;
+};
+
+struct mlfq_entity {
+	unsigned int level;
+	unsigned int used;		/* Ticks used at @level */
+	unsigned int exec_age;	/* Age when @used was updated last */
+	unsigned int epoch;		/* Boost epoch when @level was set */
+};
+
+static unsigned int __mlfq_epoch(struct sim_context *ctx)
+{
+	struct mlfq_rq *rq = ctx->sched_data;
+
+	return rq->boost ? ctx->ticks / rq->boost : 0;
+}
+
+static void __mlfq_enqueue(struct mlfq_rq *rq, struct process *p, bool head)
+{
+	struct mlfq_entity *se = p->sched_data;
+
+	if (head) {
+		list_add(&p->list, rq->lists + se->level);
+	} else {
+		list_add_tail(&p->list, rq->lists + se->level);
+	}
+	rq->bitmap |= 1ULL << se->level;
+}
+
+static void __mlfq_dequeue(struct mlfq_rq *rq, struct process *p)
+{
+	struct mlfq_entity *se = p->sched_data;
+
+	list_del_init(&p->list);
+	if (list_empty(rq->lists + se->level)) {
+		rq->bitmap &= ~(1ULL << se->level);
+	}
+}
+
+/**
+ * Move @p back to the top if a boost happened since its level was set
+ */
+static void __mlfq_refresh(struct process *p, unsigned int epoch)
+{
+	struct mlfq_entity *se = p->sched_data;
+
+	if (se->epoch == epoch) return;
+
+	se->level = 0;
+	se->used = 0;
+	se->epoch = epoch;
+}
+
+static void __mlfq_boost(struct sim_context *ctx, unsigned int epoch)
+{
+	struct mlfq_rq *rq = ctx->sched_data;
+	struct process *p, *tmp;
+
+	for (int i = 1; i < rq->nr_levels; i++) {
+		list_for_each_entry_safe(p, tmp, rq->lists + i, list) {
+			__mlfq_dequeue(rq, p);
+			__mlfq_refresh(p, epoch);
+			__mlfq_enqueue(rq, p, false);
+		}
+	}
+	list_for_each_entry(p, rq->lists, list) {
+		__mlfq_refresh(p, epoch);
+	}
+	rq->epoch = epoch;
+}
+
+static int mlfq_initialize(struct sim_context *ctx)
+{
+	struct mlfq_rq *rq = malloc(sizeof(*rq));
+	unsigned int quantum;
+	if (!rq) return -1;
+
+	ctx->sched_data = rq;
+
+	rq->bitmap = 0;
+	rq->epoch = 0;
+	rq->nr_levels = sim_option(ctx, "levels", 3);
+	rq->boost = sim_option(ctx, "boost", 100);
+
+	if (rq->nr_levels < 1 || rq->nr_levels > MLFQ_MAX_LEVELS) {
+		fprintf(stderr, "levels should be in 1..%d\n", MLFQ_MAX_LEVELS);
+		return -1;
+	}
+
+	quantum = sim_option(ctx, "quantum", ctx->quantum);
+	for (int i = 0; i < rq->nr_levels; i++) {
+		char key[16];
+
+		INIT_LIST_HEAD(rq->lists + i);
+
+		snprintf(key, sizeof(key), "quantum%d", i);
+		rq->quanta[i] = sim_option(ctx, key, quantum);
+		if (!rq->quanta[i]) {
+			fprintf(stderr, "%s should be positive\n", key);
+			return -1;
+		}
+		quantum = quantum < UINT_MAX / 2 ? quantum * 2 : UINT_MAX;
+	}
+	return 0;
+}
+
+static void mlfq_finalize(struct sim_context *ctx)
+{
+	free(ctx->sched_data);
+	ctx->sched_data = NULL;
+}
+
+static void mlfq_forked(struct sim_context *ctx, struct process *p)
+{
+	struct mlfq_entity *se = malloc(sizeof(*se));
+
+	assert(se);
+
+	se->level = 0;
+	se->used = 0;
+	se->exec_age = p->age;
+	se->epoch = __mlfq_epoch(ctx);
+
+	p->sched_data = se;
+}
+
+static void mlfq_exiting(struct sim_context *ctx, struct process *p)
+{
+	free(p->sched_data);
+	p->sched_data = NULL;
+}
+
+static struct process *mlfq_schedule(struct sim_context *ctx)
+{
+	struct mlfq_rq *rq = ctx->sched_data;
+	struct process *current = ctx->current;
+	unsigned int epoch = __mlfq_epoch(ctx);
+	struct process *p, *tmp;
+	struct mlfq_entity *se;
+
+	if (current) {
+		se = current->sched_data;
+		se->used += current->age - se->exec_age;
+		se->exec_age = current->age;
+
+		/* Blocked ones keep the quantum used so far at their level */
+		if (current->status == PROCESS_WAIT ||
+				current->age >= current->lifespan) {
+			current = NULL;
+		}
+	}
+
+	if (rq->epoch != epoch) __mlfq_boost(ctx, epoch);
+
+	list_for_each_entry_safe(p, tmp, &ctx->readyqueue, list) {
+		list_del_init(&p->list);
+		__mlfq_refresh(p, epoch);
+		__mlfq_enqueue(rq, p, false);
+	}
+
+	if (current) {
+		se = current->sched_data;
+		__mlfq_refresh(current, epoch);
+
+		if (se->used >= rq->quanta[se->level]) {
+			/* Used up the quantum. Demote to the next level if any */
+			if (se->level + 1 < rq->nr_levels) se->level++;
+			se->used = 0;
+			__mlfq_enqueue(rq, current, false);
+		} else if (rq->bitmap & ((1ULL << se->level) - 1)) {
+			/* Preempted by a higher level. Resume first at the level */
+			__mlfq_enqueue(rq, current, true);
+		} else {
+			return current;
+		}
+	}
+
+	if (!rq->bitmap) return NULL;
+
+	p = list_first_entry(rq->lists + __builtin_ctzll(rq->bitmap),
+			struct process, list);
+	__mlfq_dequeue(rq, p);
+
+	se = p->sched_data;
+	se->exec_age = p->age;
+
+	return p;
+}
+
+static unsigned int mlfq_slice(struct sim_context *ctx)
+{
+	struct mlfq_rq *rq = ctx->sched_data;
+	struct mlfq_entity *se = ctx->current->sched_data;
+	unsigned int used = se->used + ctx->current->age - se->exec_age;
+	unsigned int nr_ticks;
+
+	if (!list_empty(&ctx->readyqueue)) return 0;
+	if (used >= rq->quanta[se->level]) return 0;
+
+	/* Stop before the demotion, which changes the state even if alone */
+	nr_ticks = rq->quanta[se->level] - used;
+
+	/* and before the next boost, which may be right at this tick */
+	if (rq->boost) {
+		unsigned int to_boost = ctx->ticks % rq->boost ?
+				rq->boost - ctx->ticks % rq->boost : 0;
+
+		if (to_boost < nr_ticks) nr_ticks = to_boost;
+	}
+	return nr_ticks;
+}
+
+static struct process *mlfq_migrate(struct sim_context *ctx)
+{
+	struct mlfq_rq *rq = ctx->sched_data;
+	struct process *p;
+
+	if (!list_empty(&ctx->readyqueue)) {
+		p = list_last_entry(&ctx->readyqueue, struct process, list);
+		list_del_init(&p->list);
+		return p;
+	}
+
+	if (!rq->bitmap) return NULL;
+
+	/* The last one at the lowest level */
+	p = list_last_entry(rq->lists + 63 - __builtin_clzll(rq->bitmap),
+			struct process, list);
+	__mlfq_dequeue(rq, p);
+
+	return p;
+}
+
+struct scheduler mlfq_scheduler = {
+	.name = "Multi-Level Feedback Queue",
+	.acquire = fcfs_acquire,
+	.release = fcfs_release,
+	.initialize = mlfq_initialize,
+	.finalize = mlfq_finalize,
+	.forked = mlfq_forked,
+	.exiting = mlfq_exiting,
+	.schedule = mlfq_schedule,
+	.slice = mlfq_slice,
+	.migrate = mlfq_migrate,
+};
+
+
+/***********************************************************************
+ * Earliest-Deadline First scheduler
+ *
+ * DESCRIPTION
+ *   Run the process with the earliest absolute deadline, preempting the
+ *   current when a process with an earlier deadline shows up. Processes
+ *   without deadline run in background. Resources are handled like PIP;
+ *   the holders of a resource inherit the deadline of the waiter if it is
+ *   earlier (deadline inheritance), and the waiters with the earliest
+ *   deadline are woken up on release.
+ ***********************************************************************/
+static unsigned long long __edf_deadline_key(unsigned int deadline)
+{
+	return deadline ? deadline : ULLONG_MAX;
+}
+
+static unsigned long long edf_key(struct process *p)
+{
+	return __edf_deadline_key(p->deadline);
+}
+
+static struct process *edf_schedule(struct sim_context *ctx)
+{
+	__readypq_pull(ctx, edf_key);
+
+	/* Preempt current only when a strictly more urgent one is waiting */
+	if (__readypq_keep_current(ctx, edf_key)) {
+		return ctx->current;
+	}
+
+	if (ctx->current && ctx->current->status != PROCESS_WAIT &&
+			ctx->current->age < ctx->current->lifespan) {
+		pq_push(ctx->sched_data, &ctx->current->pq, edf_key(ctx->current));
+	}
+
+	return __readypq_pop(ctx);
+}
+
+/**
+ * Change the effective deadline of @p, which might be queued on any CPU
+ */
+static void __edf_set_deadline(struct sim_context *ctx, struct process *p,
+		unsigned int deadline)
+{
+	p->deadline = deadline;
+
+	if (pq_queued(&p->pq)) {
+		pq_update(sim_sched_data_of(ctx, p->cpu), &p->pq, edf_key(p));
+	}
+	__resource_requeue(ctx, p, edf_key(p));
+}
+
+bool edf_acquire(struct sim_context *ctx, int resource_id)
+{
+	struct resource_hold *hold;
+
+	if (__resource_available(ctx, resource_id)) return true;
+
+	__resource_wait(ctx, resource_id, edf_key(ctx->current));
+
+	list_for_each_entry(hold, &ctx->resources[resource_id].holders, holders) {
+		if (edf_key(ctx->current) < edf_key(hold->process)) {
+			__edf_set_deadline(ctx, hold->process, ctx->current->deadline);
+		}
+	}
+
+	return false;
+}
+
+/**
+ * The deadline that @p inherits through the resources it holds, from the
+ * most urgent waiter of each
+ */
+static unsigned int __edf_inherited_deadline(struct sim_context *ctx, struct process *p)
+{
+	unsigned int deadline = p->deadline_orig;
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &p->holding, holding) {
+		struct process *waiter = __resource_first_waiter(ctx, hold->resource_id);
+
+		if (waiter && edf_key(waiter) < __edf_deadline_key(deadline)) {
+			deadline = waiter->deadline;
+		}
+	}
+	return deadline;
+}
+
+void edf_release(struct sim_context *ctx, int resource_id)
+{
+	/* Wake up the waiters with the earliest deadline */
+	__resource_wake(ctx, resource_id);
+
+	/* Keep the deadline inherited through the resources still held */
+	__edf_set_deadline(ctx, ctx->current, __edf_inherited_deadline(ctx, ctx->current));
+}
+
+static void edf_cancel(struct sim_context *ctx, int resource_id)
+{
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &ctx->resources[resource_id].holders, holders) {
+		__edf_set_deadline(ctx, hold->process,
+				__edf_inherited_deadline(ctx, hold->process));
+	}
+}
+
+struct scheduler edf_scheduler = {
+	.name = "Earliest-Deadline First",
+	.acquire = edf_acquire,
+	.release = edf_release,
+	.cancel = edf_cancel,
+	.initialize = readypq_initialize,
+	.finalize = readypq_finalize,
+	.schedule = edf_schedule,
+	/**
+	 * The deadline of current changes only by acquire and release, which
+	 * stop skipping anyway. So does a new arrival.
+	 */
+	.slice = nonpreemptive_slice,
+	.migrate = readypq_migrate,
+};
+
+
+/***********************************************************************
+ * Proportional-share scheduler
+ *
+ * DESCRIPTION
+ *   A process holds (prio + 1) tickets, and gets the CPU time in proportion
+ *   to its tickets. In stride scheduling (default), a process advances its
+ *   pass by its stride (STRIDE1 / tickets) for each tick it runs, and the
+ *   one with the minimum pass runs next. Passes are kept in a pqueue so
+ *   that picking is O(log n). A process leaving the run queue keeps its
+ *   pass relative to the global pass, which advances as if all the tickets
+ *   in the run queue were running, and resumes from there. STRIDE1 is
+ *   2^32 so that the global stride, STRIDE1 over all the runnable tickets,
+ *   does not truncate to 0 even with millions of processes.
+ *
+ *   With -o lottery=1, the next process is drawn at random in proportion
+ *   to the tickets on each tick instead. This scans the run queue, so it
+ *   is O(n). -o seed=N changes the random sequence.
+ *
+ *   A process blocked on a resource transfers its tickets to the holders
+ *   of the resource until it is woken up, so that the holders get out of
+ *   its way sooner. The tickets are split among the holders, so a waiter
+ *   for a shared resource does not multiply its tickets by lending them
+ *   to every reader, and a process never has more than STRIDE1 tickets
+ *   lest its stride be 0.
+ ***********************************************************************/
+#define STRIDE1		(1ULL << 32)
+
+struct stride_rq {
+	struct pqueue timeline;		/* Ready processes ordered by pass */
+	unsigned long long global_pass;
+	unsigned long long global_tickets;	/* Tickets of the runnable processes */
+	unsigned int updated_at;		/* Tick when @global_pass was updated */
+
+	bool lottery;
+	unsigned long long seed;
+};
+
+struct stride_entity {
+	unsigned long long tickets;	/* Including the ones transferred by waiters */
+	unsigned long long pass;
+	unsigned int exec_age;	/* Age when @pass was updated last */
+
+	struct stride_rq *rq;	/* The rq counting the tickets. NULL if not runnable */
+	bool relative;			/* @pass is relative to the global pass */
+};
+
+static unsigned long long __stride_of(struct stride_entity *se)
+{
+	unsigned long long stride = STRIDE1 / se->tickets;
+
+	return stride ? stride : 1;
+}
+
+static void __stride_update_global(struct stride_rq *rq, unsigned int ticks)
+{
+	if (rq->global_tickets) {
+		rq->global_pass += (ticks - rq->updated_at) * (STRIDE1 / rq->global_tickets);
+	}
+	rq->updated_at = ticks;
+}
+
+/**
+ * Advance the pass of @p by the ticks it has run since the last update.
+ * Processes do not age while not running, so it is safe for any process
+ */
+static void __stride_update_curr(struct process *p)
+{
+	struct stride_entity *se = p->sched_data;
+
+	se->pass += (p->age - se->exec_age) * __stride_of(se);
+	se->exec_age = p->age;
+}
+
+static void __stride_unaccount(struct sim_context *ctx, struct stride_entity *se)
+{
+	__stride_update_global(se->rq, ctx->ticks);
+
+	se->pass -= se->rq->global_pass;
+	se->relative = true;
+	se->rq->global_tickets -= se->tickets;
+	se->rq = NULL;
+}
+
+static void __stride_account(struct sim_context *ctx, struct stride_rq *rq,
+		struct stride_entity *se)
+{
+	__stride_update_global(rq, ctx->ticks);
+
+	if (se->relative) {
+		se->pass += rq->global_pass;
+		se->relative = false;
+	}
+	se->rq = rq;
+	rq->global_tickets += se->tickets;
+}
+
+static unsigned long long __stride_random(struct stride_rq *rq)
+{
+	/* xorshift64* */
+	rq->seed ^= rq->seed >> 12;
+	rq->seed ^= rq->seed << 25;
+	rq->seed ^= rq->seed >> 27;
+	return rq->seed * 2685821657736338717ULL;
+}
+
+/**
+ * Tickets of @p including its share of the ones transferred by the waiters
+ * of the resources that @p is holding, clamped to 1..STRIDE1
+ */
+static unsigned long long __stride_tickets(struct sim_context *ctx, struct process *p)
+{
+	unsigned long long tickets = (unsigned long long)p->prio + 1;	/* Never 0 */
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &p->holding, holding) {
+		struct resource *r = ctx->resources + hold->resource_id;
+		unsigned int nr_holders = r->nr_exclusive + r->nr_shared;
+		struct process *waiter;
+
+		list_for_each_entry(waiter, &r->waitqueue, list) {
+			tickets += ((struct stride_entity *)waiter->sched_data)->tickets / nr_holders;
+		}
+	}
+	return tickets < STRIDE1 ? tickets : STRIDE1;
+}
+
+static void __stride_set_tickets(struct sim_context *ctx, struct process *p,
+		unsigned long long tickets)
+{
+	struct stride_entity *se = p->sched_data;
+
+	if (tickets == se->tickets) return;
+
+	/* Account the ticks run with the previous stride */
+	__stride_update_curr(p);
+
+	if (se->rq) {
+		__stride_update_global(se->rq, ctx->ticks);
+		se->rq->global_tickets += tickets - se->tickets;
+	}
+	se->tickets = tickets;
+}
+
+/**
+ * Recompute the tickets of the holders of @resource_id as its waiters
+ * come and go
+ */
+static void __stride_reticket_holders(struct sim_context *ctx, int resource_id)
+{
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &ctx->resources[resource_id].holders, holders) {
+		__stride_set_tickets(ctx, hold->process,
+				__stride_tickets(ctx, hold->process));
+	}
+}
+
+bool stride_acquire(struct sim_context *ctx, int resource_id)
+{
+	if (fcfs_acquire(ctx, resource_id)) return true;
+
+	/**
+	 * Leave the run queue now. The holders may wake us up on another CPU
+	 * before this CPU schedules again
+	 */
+	__stride_update_curr(ctx->current);
+	__stride_unaccount(ctx, ctx->current->sched_data);
+
+	/* Lend the tickets to the holders */
+	__stride_reticket_holders(ctx, resource_id);
+
+	return false;
+}
+
+void stride_release(struct sim_context *ctx, int resource_id)
+{
+	fcfs_release(ctx, resource_id);
+
+	/* Take back the tickets lent through the resource */
+	__stride_set_tickets(ctx, ctx->current, __stride_tickets(ctx, ctx->current));
+
+	/* Including the ones lent to the holders left by the waiters woken up */
+	__stride_reticket_holders(ctx, resource_id);
+}
+
+/**
+ * Take back the tickets that a waiter of @resource_id has lent to the
+ * holders before giving up
+ */
+static void stride_cancel(struct sim_context *ctx, int resource_id)
+{
+	__stride_reticket_holders(ctx, resource_id);
+}
+
+static int stride_initialize(struct sim_context *ctx)
+{
+	struct stride_rq *rq = malloc(sizeof(*rq));
+	if (!rq) return -1;
+
+	pq_init(&rq->timeline);
+	rq->global_pass = 0;
+	rq->global_tickets = 0;
+	rq->updated_at = 0;
+
+	rq->lottery = sim_option(ctx, "lottery", 0);
+	rq->seed = sim_option(ctx, "seed", 1) + ctx->cpu * 0x9e3779b97f4a7c15ULL;
+	if (!rq->seed) rq->seed = 1;
+
+	ctx->sched_data = rq;
+	return 0;
+}
+
+static void stride_finalize(struct sim_context *ctx)
+{
+	struct stride_rq *rq = ctx->sched_data;
+
+	pq_destroy(&rq->timeline);
+	free(rq);
+	ctx->sched_data = NULL;
+}
+
+static void stride_forked(struct sim_context *ctx, struct process *p)
+{
+	struct stride_entity *se = malloc(sizeof(*se));
+
+	assert(se);
+
+	se->tickets = __stride_tickets(ctx, p);
+	se->pass = 0;
+	se->exec_age = p->age;
+	se->rq = NULL;
+	se->relative = true;	/* Join at the global pass */
+
+	p->sched_data = se;
+}
+
+static void stride_exiting(struct sim_context *ctx, struct process *p)
+{
+	struct stride_entity *se = p->sched_data;
+
+	if (se->rq) __stride_unaccount(ctx, se);
+
+	free(se);
+	p->sched_data = NULL;
+}
+
+/**
+ * Draw a process among @current and the ones on the timeline
+ */
+static struct process *__lottery_draw(struct stride_rq *rq, struct process *current)
+{
+	unsigned long long winner = __stride_random(rq) % rq->global_tickets;
+	struct stride_entity *se;
+
+	if (current) {
+		se = current->sched_data;
+		if (winner < se->tickets) return current;
+		winner -= se->tickets;
+	}
+
+	for (unsigned int i = 1; i <= rq->timeline.nr; i++) {
+		struct process *p = pq_entry(rq->timeline.heap[i], struct process, pq);
+
+		se = p->sched_data;
+		if (winner < se->tickets) return p;
+		winner -= se->tickets;
+	}
+	assert(0 && "Tickets are not accounted properly");
+	return NULL;
+}
+
+static struct process *stride_schedule(struct sim_context *ctx)
+{
+	struct stride_rq *rq = ctx->sched_data;
+	struct process *current = ctx->current;
+	struct process *p, *tmp;
+	struct pq_node *leftmost;
+	struct stride_entity *se;
+
+	if (current) {
+		__stride_update_curr(current);
+
+		if (current->status == PROCESS_WAIT) {
+			/* Blocked on I/O rather than in stride_acquire() */
+			se = current->sched_data;
+			if (se->rq) __stride_unaccount(ctx, se);
+			current = NULL;
+		} else if (current->age >= current->lifespan) {
+			__stride_unaccount(ctx, current->sched_data);
+			current = NULL;
+		}
+	}
+
+	list_for_each_entry_safe(p, tmp, &ctx->readyqueue, list) {
+		se = p->sched_data;
+
+		list_del_init(&p->list);
+		__stride_account(ctx, rq, se);
+		pq_push(&rq->timeline, &p->pq, se->pass);
+	}
+
+	if (pq_empty(&rq->timeline)) return current;
+
+	if (rq->lottery) {
+		p = __lottery_draw(rq, current);
+		if (p == current) return current;
+
+		pq_remove(&rq->timeline, &p->pq);
+	} else {
+		leftmost = pq_peek(&rq->timeline);
+		if (current && ((struct stride_entity *)current->sched_data)->pass <= leftmost->key) {
+			return current;
+		}
+
+		pq_remove(&rq->timeline, leftmost);
+		p = pq_entry(leftmost, struct process, pq);
+	}
+
+	if (current) {
+		se = current->sched_data;
+		pq_push(&rq->timeline, &current->pq, se->pass);
+	}
+
+	se = p->sched_data;
+	se->exec_age = p->age;
+
+	return p;
+}
+
+static unsigned int stride_slice(struct sim_context *ctx)
+{
+	struct stride_rq *rq = ctx->sched_data;
+	struct process *current = ctx->current;
+	struct stride_entity *se = current->sched_data;
+	unsigned long long pass;
+	struct pq_node *leftmost;
+
+	if (!list_empty(&ctx->readyqueue)) return 0;
+	if (pq_empty(&rq->timeline)) return UINT_MAX;
+	if (rq->lottery) return 0;
+
+	/* Keep running while the pass does not go beyond the leftmost */
+	pass = se->pass + (current->age - se->exec_age) * __stride_of(se);
+	leftmost = pq_peek(&rq->timeline);
+	if (pass > leftmost->key) return 0;
+
+	return (leftmost->key - pass) / __stride_of(se) + 1;
+}
+
+static struct process *stride_migrate(struct sim_context *ctx)
+{
+	struct stride_rq *rq = ctx->sched_data;
+	struct pq_node *node;
+	struct process *p;
+
+	if (!list_empty(&ctx->readyqueue)) {
+		p = list_last_entry(&ctx->readyqueue, struct process, list);
+		list_del_init(&p->list);
+		return p;
+	}
+
+	node = pq_last(&rq->timeline);
+	if (!node) return NULL;
+
+	pq_remove(&rq->timeline, node);
+	p = pq_entry(node, struct process, pq);
+	__stride_unaccount(ctx, p->sched_data);
+
+	return p;
+}
+
+struct scheduler stride_scheduler = {
+	.name = "Proportional-Share",
+	.acquire = stride_acquire,
+	.release = stride_release,
+	.cancel = stride_cancel,
+	.initialize = stride_initialize,
+	.finalize = stride_finalize,
+	.forked = stride_forked,
+	.exiting = stride_exiting,
+	.schedule = stride_schedule,
+	.slice = stride_slice,
+	.migrate = stride_migrate,
+};
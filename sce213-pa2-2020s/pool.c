@@ -0,0 +1,114 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "types.h"
+#include "pool.h"
+
+/**
+ * Each chunk begins with the header linking the chunks of the pool, and
+ * the objects follow from the next cache line
+ */
+struct sim_pool_chunk {
+	struct sim_pool_chunk *next;
+};
+
+void sim_pool_init(struct sim_pool *pool, size_t size, unsigned int nr_per_chunk)
+{
+	size_t aligned = sizeof(void *);
+
+	if (size > SIM_CACHE_LINE) {
+		aligned = (size + SIM_CACHE_LINE - 1) & ~((size_t)SIM_CACHE_LINE - 1);
+	} else {
+		while (aligned < size) aligned <<= 1;
+	}
+
+	pool->size = aligned;
+	pool->nr_per_chunk = nr_per_chunk ? nr_per_chunk : 1;
+	pool->freelist = NULL;
+	pool->chunks = NULL;
+}
+
+void sim_pool_destroy(struct sim_pool *pool)
+{
+	struct sim_pool_chunk *chunk = pool->chunks;
+
+	while (chunk) {
+		struct sim_pool_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	pool->freelist = NULL;
+	pool->chunks = NULL;
+}
+
+/**
+ * Add a chunk of @nr objects in front of the freelist, in the address order
+ */
+static bool __grow_pool(struct sim_pool *pool, size_t nr)
+{
+	struct sim_pool_chunk *chunk;
+	uintptr_t objs;
+	void **prev = &pool->freelist;
+	void *tail = pool->freelist;
+
+	chunk = malloc(sizeof(*chunk) + SIM_CACHE_LINE - 1 + nr * pool->size);
+	if (!chunk) return false;
+
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+
+	objs = ((uintptr_t)(chunk + 1) + SIM_CACHE_LINE - 1) &
+			~(uintptr_t)(SIM_CACHE_LINE - 1);
+
+	for (size_t i = 0; i < nr; i++) {
+		void *obj = (void *)(objs + i * pool->size);
+
+		*prev = obj;
+		prev = (void **)obj;
+	}
+	*prev = tail;
+
+	return true;
+}
+
+void *sim_pool_alloc(struct sim_pool *pool)
+{
+	void *obj;
+
+	if (!pool->freelist && !__grow_pool(pool, pool->nr_per_chunk)) {
+		return NULL;
+	}
+
+	obj = pool->freelist;
+	pool->freelist = *(void **)obj;
+	return obj;
+}
+
+void sim_pool_free(struct sim_pool *pool, void *obj)
+{
+	if (!obj) return;
+
+	*(void **)obj = pool->freelist;
+	pool->freelist = obj;
+}
+
+bool sim_pool_reserve(struct sim_pool *pool, size_t nr)
+{
+	if (!nr) return true;
+	return __grow_pool(pool, nr);
+}
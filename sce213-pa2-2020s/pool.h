@@ -0,0 +1,64 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+
+#include "types.h"
+
+#define SIM_CACHE_LINE	64
+
+/***********************************************************************
+ * struct sim_pool
+ *
+ * DESCRIPTION
+ *   Slab-style allocator of fixed-size objects. Objects are carved out of
+ *   cache-line-aligned chunks, and freed objects are kept in @freelist to
+ *   be reused rather than returned to malloc. An object larger than a cache
+ *   line starts on a cache line, and a smaller one never straddles two, so
+ *   the fields at the head of the object (e.g., @status, @age, @prio, and
+ *   @list of struct process) share a cache line.
+ *
+ *   sim_pool_reserve() carves @nr objects out of a single chunk at once,
+ *   and the following sim_pool_alloc() calls return them in the address
+ *   order. sim_pool_destroy() releases all the chunks, including the
+ *   objects still allocated.
+ */
+struct sim_pool {
+	size_t size;			/* Size of an object, rounded up as above */
+	unsigned int nr_per_chunk;	/* # of objects to grow the pool by */
+
+	void *freelist;			/* Linked through the first word of free objects */
+	void *chunks;			/* Linked through the header of chunks */
+};
+
+void sim_pool_init(struct sim_pool *pool, size_t size, unsigned int nr_per_chunk);
+void sim_pool_destroy(struct sim_pool *pool);
+
+/**
+ * Return an object, or NULL if out of memory. The object is not cleared
+ */
+void *sim_pool_alloc(struct sim_pool *pool);
+void sim_pool_free(struct sim_pool *pool, void *obj);
+
+/**
+ * Make the next @nr allocations served from a single chunk. Return false
+ * if out of memory
+ */
+bool sim_pool_reserve(struct sim_pool *pool, size_t nr);
+
+#endif
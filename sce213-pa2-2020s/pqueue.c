@@ -0,0 +1,146 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+
+static inline bool __pq_before(struct pq_node *a, struct pq_node *b)
+{
+	if (a->key != b->key) return a->key < b->key;
+	return a->seq < b->seq;
+}
+
+static inline void __pq_set(struct pqueue *pq, unsigned int index, struct pq_node *node)
+{
+	pq->heap[index] = node;
+	node->index = index;
+}
+
+static void __pq_sift_up(struct pqueue *pq, unsigned int index)
+{
+	struct pq_node *node = pq->heap[index];
+
+	while (index > 1) {
+		struct pq_node *parent = pq->heap[index / 2];
+		if (!__pq_before(node, parent)) break;
+
+		__pq_set(pq, index, parent);
+		index /= 2;
+	}
+	__pq_set(pq, index, node);
+}
+
+static void __pq_sift_down(struct pqueue *pq, unsigned int index)
+{
+	struct pq_node *node = pq->heap[index];
+
+	while (index * 2 <= pq->nr) {
+		unsigned int child = index * 2;
+
+		if (child + 1 <= pq->nr &&
+				__pq_before(pq->heap[child + 1], pq->heap[child])) {
+			child++;
+		}
+		if (!__pq_before(pq->heap[child], node)) break;
+
+		__pq_set(pq, index, pq->heap[child]);
+		index = child;
+	}
+	__pq_set(pq, index, node);
+}
+
+void pq_init(struct pqueue *pq)
+{
+	pq->heap = NULL;
+	pq->nr = 0;
+	pq->capacity = 0;
+	pq->seq = 0;
+}
+
+void pq_destroy(struct pqueue *pq)
+{
+	for (unsigned int i = 1; i <= pq->nr; i++) {
+		pq->heap[i]->index = 0;
+	}
+	free(pq->heap);
+	pq_init(pq);
+}
+
+void pq_push(struct pqueue *pq, struct pq_node *node, unsigned long long key)
+{
+	assert(!pq_queued(node));
+
+	if (pq->nr + 1 >= pq->capacity) {
+		pq->capacity = pq->capacity ? pq->capacity * 2 : 8;
+		pq->heap = realloc(pq->heap, sizeof(*pq->heap) * pq->capacity);
+		assert(pq->heap);
+	}
+
+	node->key = key;
+	node->seq = pq->seq++;
+
+	pq->nr++;
+	__pq_set(pq, pq->nr, node);
+	__pq_sift_up(pq, pq->nr);
+}
+
+struct pq_node *pq_pop(struct pqueue *pq)
+{
+	struct pq_node *top = pq_peek(pq);
+
+	if (top) pq_remove(pq, top);
+
+	return top;
+}
+
+void pq_remove(struct pqueue *pq, struct pq_node *node)
+{
+	unsigned int index = node->index;
+	struct pq_node *last;
+
+	assert(index && index <= pq->nr && pq->heap[index] == node);
+
+	last = pq->heap[pq->nr--];
+	node->index = 0;
+
+	if (last == node) return;
+
+	__pq_set(pq, index, last);
+	if (index > 1 && __pq_before(last, pq->heap[index / 2])) {
+		__pq_sift_up(pq, index);
+	} else {
+		__pq_sift_down(pq, index);
+	}
+}
+
+void pq_update(struct pqueue *pq, struct pq_node *node, unsigned long long key)
+{
+	assert(pq_queued(node));
+
+	if (key == node->key) return;
+
+	if (key < node->key) {
+		node->key = key;
+		__pq_sift_up(pq, node->index);
+	} else {
+		node->key = key;
+		__pq_sift_down(pq, node->index);
+	}
+}
@@ -0,0 +1,110 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PQUEUE_H__
+#define __PQUEUE_H__
+
+/***********************************************************************
+ * Intrusive binary min-heap
+ *
+ * DESCRIPTION
+ *   Like struct list_head, struct pq_node is embedded in the object to
+ *   queue, and the object is retrieved with pq_entry(). Nodes are ordered
+ *   by @key, and nodes with the same key are ordered by their insertion
+ *   order (FIFO). To build a max-heap, push the negated (or complemented)
+ *   key.
+ *
+ *   All operations are O(log n) except pq_peek() and pq_empty() which are
+ *   O(1).
+ */
+struct pq_node {
+	unsigned long long key;	/* Primary sort key. The smaller, the earlier */
+	unsigned long long seq;	/* Insertion order for FIFO tie-break */
+	unsigned int index;		/* 1-based position in the heap. 0 if not queued */
+};
+
+struct pqueue {
+	struct pq_node **heap;	/* heap[1] is the top. heap[0] is not used */
+	unsigned int nr;		/* Number of queued nodes */
+	unsigned int capacity;	/* Allocated slots in @heap */
+	unsigned long long seq;	/* Next insertion sequence number */
+};
+
+#define pq_entry(ptr, type, member) \
+	container_of(ptr, type, member)
+
+static inline void INIT_PQ_NODE(struct pq_node *node)
+{
+	node->key = 0;
+	node->seq = 0;
+	node->index = 0;
+}
+
+static inline bool pq_empty(struct pqueue *pq)
+{
+	return pq->nr == 0;
+}
+
+static inline bool pq_queued(struct pq_node *node)
+{
+	return node->index != 0;
+}
+
+static inline struct pq_node *pq_peek(struct pqueue *pq)
+{
+	return pq->nr ? pq->heap[1] : NULL;
+}
+
+/**
+ * pq_last - return the node at the bottom of the heap
+ *
+ * The node is a leaf, so it is one of the later ones, but not necessarily
+ * the last one. Removing it is O(1). Return NULL if @pq is empty.
+ */
+static inline struct pq_node *pq_last(struct pqueue *pq)
+{
+	return pq->nr ? pq->heap[pq->nr] : NULL;
+}
+
+void pq_init(struct pqueue *pq);
+void pq_destroy(struct pqueue *pq);
+
+/**
+ * pq_push - queue @node with @key
+ *
+ * @node should not be queued in any pqueue.
+ */
+void pq_push(struct pqueue *pq, struct pq_node *node, unsigned long long key);
+
+/**
+ * pq_pop - dequeue the node with the smallest key
+ *
+ * Return NULL if @pq is empty.
+ */
+struct pq_node *pq_pop(struct pqueue *pq);
+
+/**
+ * pq_remove - dequeue @node from anywhere in @pq
+ */
+void pq_remove(struct pqueue *pq, struct pq_node *node);
+
+/**
+ * pq_update - change the key of queued @node to @key
+ *
+ * The node keeps its insertion order among the nodes with the same key.
+ */
+void pq_update(struct pqueue *pq, struct pq_node *node, unsigned long long key);
+
+#endif
@@ -17,6 +17,8 @@
 #define __PROCESS_H__
 
 struct list_head;
+struct pq_node;
+struct pqueue;
 
 enum process_status {
 	PROCESS_READY,		/* Process is ready to run */
@@ -41,20 +43,71 @@ struct process {
 
 	struct list_head list;	/* list head for listing processes */
 
+	struct pq_node pq;		/* pqueue node for key-ordered queues */
+
+	struct pq_node waiting;	/* pqueue node for the waiters of a resource */
+	int waiting_on;			/* Resource that the process is waiting for.
+							   -1 if not waiting for any */
+	bool shared;			/* Whether the resource to acquire (or waited
+							   for) is requested in the shared mode. Set by
+							   the framework before scheduler.acquire() */
+
+	struct list_head holding;
+							/* struct resource_hold of the resources that
+							   the process is holding */
+
 	/**
 	 * You might need following(s) to implement PIP
 	 */
 	unsigned int prio_orig;	/* The original priority of the process */
 
+	/**
+	 * Timing constraints of real-time processes. @deadline is the absolute
+	 * tick by which the process (a job of a periodic process) should
+	 * complete, or 0 if it has no deadline. Like @prio, @deadline might
+	 * be inherited through resources while @deadline_orig is not.
+	 */
+	unsigned int deadline;
+	unsigned int deadline_orig;
+	unsigned int period;	/* Release interval of the jobs. 0 if not periodic */
+
+	unsigned int cpu;		/* CPU that the process is running or queued on */
+
+	void *sched_data;		/* Private data of the scheduler for the process.
+							   malloc() it in scheduler.forked() if needed.
+							   The framework frees it if the process never
+							   exits (e.g., left in a deadlock) */
+
 
 	/* DO NOT ACCESS FOLLOWING VARIABLES */
 	unsigned int __starts_at;	/* When to fork the process */
+	struct list_head __forked;	/* Linked while forked and not exited */
 
 	struct list_head __resources_to_acquire;
 								/* Schedule to acquire resources */
 
-	struct list_head __resources_holding;
-								/* Resources that the process is currently holding */
+	struct pqueue __resources_releasing;
+								/* Holding resources ordered by the age to release */
+
+	unsigned int __job;			/* Index of the job of a periodic process */
+	unsigned int __blocked_at;	/* When the process was blocked last */
+	unsigned int __blocked;		/* # of ticks blocked on resources */
+	int __blocked_on;			/* Resource that the process was blocked on last */
+	unsigned int __first_run;	/* When dispatched first. UINT_MAX until then */
+	unsigned int __traced_prio;	/* Priority logged last */
+	bool __inverted;			/* The last blocking was a priority inversion */
+	unsigned int __inversion;	/* # of ticks blocked by priority inversions */
+	unsigned int __chain;		/* Longest blocking chain the process was blocked by */
+	unsigned int __walk;		/* Walk of the wait-for graph that visited last */
+	unsigned int __depth;		/* Longest blocking chain found in the walk */
+	struct process *__walked_from;	/* The process the walk came from */
+
+	struct list_head __io_to_issue;
+								/* Schedule to issue I/O, sorted by the age */
+	int __io_device;			/* Device serving the I/O in flight */
+	unsigned int __io_duration;	/* Ticks for the device to serve it */
+	unsigned int __io_at;		/* When the I/O was issued */
+	unsigned int __io;			/* # of ticks spent in I/O */
 };
 
 /**
@@ -18,27 +18,73 @@
 
 struct process;
 struct list_head;
+struct pqueue;
+
+/**
+ * A process holding a resource, linked in @holders of the resource and in
+ * @holding of the process
+ */
+struct resource_hold {
+	struct process *process;
+	int resource_id;
+	bool shared;			/* Held in the shared mode */
+
+	struct list_head holders;
+	struct list_head holding;
+};
 
 /**
  * Resources in the system.
  */
 struct resource {
 	/**
-	 * The owner process of this resource. NULL implies the resource is free
-	 * whereas non-NULL implies @owner process owns this resource
+	 * The number of units of this resource. Up to @units processes can
+	 * hold it exclusively at the same time, one unit each. 1 (i.e., a
+	 * mutex) unless the script says otherwise with a resource line
 	 */
-	struct process *owner;
+	unsigned int units;
+
+	/**
+	 * The processes holding this resource as struct resource_hold, of
+	 * which @nr_exclusive hold a unit each and @nr_shared share the
+	 * resource. Shared and exclusive holders never hold it together.
+	 * The framework keeps them up to date when scheduler.acquire() grants
+	 * the resource and right before scheduler.release() is called, so
+	 * an empty @holders implies the resource is free
+	 */
+	struct list_head holders;
+	unsigned int nr_exclusive;
+	unsigned int nr_shared;
 
 	/**
 	 * list head to list processes that are wanting for the resource
 	 */
 	struct list_head waitqueue;
+
+	/**
+	 * The processes in @waitqueue ordered by the key given by the
+	 * scheduler (e.g., the priority) through their @waiting. See
+	 * "Resource wait queues" in pa2.c
+	 */
+	struct pqueue waiters;
+
+	/**
+	 * The process holding this resource for the schedulers that serve
+	 * the resources as mutexes by themselves through legacy.h. The
+	 * framework keeps it NULL and never looks at it
+	 */
+	struct process *owner;
+
+
+	/* DO NOT ACCESS FOLLOWING VARIABLES */
+	unsigned int __blocked;		/* # of ticks processes were blocked on this */
 };
 
 /**
- * This system has 32 different resources. It is defined in pa2.c as an array of
- * struct resource (i.e., struct resource resources[NR_RESOURCES];)
+ * Resources are numbered from 0, and @resources of struct sim_context has
+ * as many of them as the largest number in the script (@nr_resources).
+ * The numbers should be less than MAX_RESOURCES
  */
-#define NR_RESOURCES 32
+#define MAX_RESOURCES	65536
 
 #endif
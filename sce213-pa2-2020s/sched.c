@@ -20,37 +20,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-#include <unistd.h>
-#include <getopt.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "types.h"
 #include "list_head.h"
+#include "pqueue.h"
 
 #include "parser.h"
 #include "process.h"
 #include "resource.h"
 
 #include "sched.h"
-
-/**
- * List head to hold the processes ready to run
- */
-LIST_HEAD(readyqueue);
-
-/**
- * The process that is currently running
- */
-struct process *current = NULL;
-
-/**
- * Number of generated ticks since the simulator was started
- */
-unsigned int ticks = 0;
-
-/**
- * Resources in the system.
- */
-struct resource resources[NR_RESOURCES];
+#include "sim.h"
+#include "trace.h"
+#include "workload.h"
 
 /**
  * Following code is to maintain the simulator itself.
@@ -59,12 +44,22 @@ struct resource_schedule {
 	int resource_id;
 	int at;
 	int duration;
+	bool shared;		/* acquire-shared */
 	struct list_head list;
+	struct pq_node pq;	/* Keyed by the age to release the resource */
+	struct resource_hold hold;	/* While holding the resource */
 };
 
-static LIST_HEAD(__forkqueue);
+/**
+ * The context of the simulation running on this thread. This is for the
+ * callbacks that are not given the context (see legacy.h)
+ */
+static __thread struct sim_context *__sim_this = NULL;
 
-bool quiet = false;
+struct sim_context *sim_this(void)
+{
+	return __sim_this;
+}
 
 static const char * __process_status_sz[] = {
 	"RDY",
@@ -83,42 +78,155 @@ extern struct scheduler rr_scheduler;
 extern struct scheduler prio_scheduler;
 extern struct scheduler pcp_scheduler;
 extern struct scheduler pip_scheduler;
+extern struct scheduler cfs_scheduler;
+extern struct scheduler mlfq_scheduler;
+extern struct scheduler edf_scheduler;
+extern struct scheduler stride_scheduler;
 
-static struct scheduler *sched = &fifo_scheduler;
+struct scheduler *sim_find_scheduler(int opt)
+{
+	switch (opt) {
+	case 'f': return &fifo_scheduler;
+	case 's': return &sjf_scheduler;
+	case 'S': return &srtf_scheduler;
+	case 'r': return &rr_scheduler;
+	case 'p': return &prio_scheduler;
+	case 'c': return &pcp_scheduler;
+	case 'i': return &pip_scheduler;
+	case 'C': return &cfs_scheduler;
+	case 'm': return &mlfq_scheduler;
+	case 'E': return &edf_scheduler;
+	case 't': return &stride_scheduler;
+	}
+	return NULL;
+}
 
-void dump_status(void)
+unsigned int sim_option(struct sim_context *ctx, const char *key, unsigned int value)
 {
-	struct process *p;
+	const char *option = ctx->options;
+	size_t len = strlen(key);
 
-	printf("***** CURRENT *********\n");
-	if (current) {
-		printf("%2d (%s): %d + %d/%d at %d\n",
-				current->pid, __process_status_sz[current->status],
-				current->__starts_at,
-				current->age, current->lifespan, current->prio);
+	while (option && *option) {
+		if (strncmp(option, key, len) == 0 && option[len] == '=') {
+			value = strtoul(option + len + 1, NULL, 0);
+		}
+		option = strchr(option, ',');
+		if (option) option++;
 	}
+	return value;
+}
+
+static void __dump_process(struct process *p)
+{
+	printf("%2d (%s): %d + %d/%d at %d\n",
+			p->pid, __process_status_sz[p->status],
+			p->__starts_at, p->age, p->lifespan, p->prio);
+}
+
+void sim_dump_status(struct sim_context *ctx)
+{
+	struct process *p;
+	struct sim_record *rec;
+	unsigned int nr_jobs = 0, nr_misses = 0, nr_devices = 0;
+	int max_lateness = INT_MIN;
+
+	for (unsigned int cpu = 0; cpu < ctx->nr_cpus; cpu++) {
+		if (ctx->nr_cpus > 1) {
+			printf("***** CPU %-3u *********\n", cpu);
+		}
+
+		printf("***** CURRENT *********\n");
+		if ((p = sim_current_of(ctx, cpu))) {
+			__dump_process(p);
+		}
 
-	printf("***** READY QUEUE *****\n");
-	list_for_each_entry(p, &readyqueue, list) {
-		printf("%2d (%s): %d + %d/%d at %d\n",
-				p->pid, __process_status_sz[p->status],
-				p->__starts_at, p->age, p->lifespan, p->prio);
+		printf("***** READY QUEUE *****\n");
+		list_for_each_entry(p, sim_readyqueue_of(ctx, cpu), list) {
+			__dump_process(p);
+		}
 	}
 
 	printf("***** RESOURCES *******\n");
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		struct resource *r = resources + i;;
-		if (r->owner || !list_empty(&r->waitqueue)) {
-			printf("%2d: owned by ", i);
-			if (r->owner) {
-				printf("%d\n", r->owner->pid);
-			} else {
-				printf("no one\n");
-			}
+	for (unsigned int i = 0; i < ctx->nr_resources; i++) {
+		struct resource *r = ctx->resources + i;
+		struct resource_hold *hold;
 
-			list_for_each_entry(p, &r->waitqueue, list) {
-				printf("    %d is waiting\n", p->pid);
-			}
+		if (list_empty(&r->holders) && list_empty(&r->waitqueue)) continue;
+
+		printf("%2d: owned by", i);
+		if (list_empty(&r->holders)) printf(" no one");
+		list_for_each_entry(hold, &r->holders, holders) {
+			printf(" %d", hold->process->pid);
+		}
+		if (r->nr_shared) printf(" (shared)");
+		if (r->units > 1) printf(", %u of %u units", r->nr_exclusive, r->units);
+		printf("\n");
+
+		list_for_each_entry(p, &r->waitqueue, list) {
+			printf("    %d is waiting%s\n", p->pid, p->shared ? " (shared)" : "");
+		}
+	}
+
+	list_for_each_entry(rec, &ctx->records, list) {
+		int lateness = (int)rec->finish - (int)rec->deadline;
+		int laxity = (int)rec->deadline - (int)rec->arrival - (int)rec->lifespan;
+
+		if (!rec->deadline) continue;
+
+		if (!nr_jobs) printf("***** DEADLINES *******\n");
+		printf("%2d.%-2u: %d -> %d due %d, lateness %d, laxity %d, blocked %u%s\n",
+				rec->pid, rec->job, rec->arrival, rec->finish, rec->deadline,
+				lateness, laxity, rec->blocked, lateness > 0 ? " MISSED" : "");
+
+		nr_jobs++;
+		if (lateness > 0) nr_misses++;
+		if (lateness > max_lateness) max_lateness = lateness;
+	}
+	if (nr_jobs) {
+		printf("%u job%s, %u missed, max lateness %d\n",
+				nr_jobs, nr_jobs >= 2 ? "s" : "", nr_misses, max_lateness);
+	}
+
+	for (int i = 0; i < NR_DEVICES; i++) {
+		struct sim_device *dev = ctx->devices + i;
+
+		if (!dev->nr_requests && list_empty(&dev->queue)) continue;
+
+		if (!nr_devices++) printf("***** DEVICES *********\n");
+		printf("%2d: %u request%s, %u ticks busy", i, dev->nr_requests,
+				dev->nr_requests >= 2 ? "s" : "", dev->nr_busy);
+		if (dev->serving) {
+			printf(", serving %d until %u", dev->serving->pid, dev->done_at);
+		}
+		printf("\n");
+
+		list_for_each_entry(p, &dev->queue, list) {
+			printf("    %d is waiting\n", p->pid);
+		}
+	}
+
+	if (ctx->__nr_deadlocks) {
+		printf("***** DEADLOCKS *******\n");
+		printf("%u deadlock%s, %u process%s killed\n",
+				ctx->__nr_deadlocks, ctx->__nr_deadlocks != 1 ? "s" : "",
+				ctx->__nr_killed, ctx->__nr_killed != 1 ? "es" : "");
+	}
+
+	if (ctx->switch_cost) {
+		printf("***** SWITCHES ********\n");
+		printf("%u context switches, %u ticks lost (%.1f%% of the capacity)\n",
+				ctx->__nr_switches, ctx->__nr_switch_ticks,
+				ctx->ticks ? ctx->__nr_switch_ticks * 100.0 / ctx->ticks / ctx->nr_cpus : 0.0);
+	}
+
+	if (ctx->nr_cpus > 1 && ctx->cpus) {
+		printf("***** CPUS ************\n");
+		for (unsigned int cpu = 0; cpu < ctx->nr_cpus; cpu++) {
+			struct sim_cpu *c = ctx->cpus + cpu;
+
+			printf("%2u: %5.1f%% busy, %u blocked, %u idle, %u migrated in, %u switches\n",
+					cpu, ctx->ticks ? c->nr_busy * 100.0 / ctx->ticks : 0.0,
+					c->nr_blocked, c->nr_idle, c->nr_migrations, c->nr_switches);
 		}
 	}
 	printf("\n\n");
@@ -126,40 +234,235 @@ void dump_status(void)
 	return;
 }
 
-#define __print_event(pid, string, args...) do { \
-	fprintf(stderr, "%3d: ", ticks); \
-	for (int i = 0; i < pid; i++) { \
-		fprintf(stderr, "    "); \
-	} \
-	fprintf(stderr, string "\n", ##args); \
-} while (0);
+void dump_status(void)
+{
+	sim_dump_status(sim_this());
+}
+
+/**
+ * Log an event on @cpu into the binary event log if enabled (-b), or print
+ * it out to the text timeline otherwise
+ */
+static void __trace_event(struct sim_context *ctx, unsigned int cpu,
+		int pid, enum sim_event_type type, int arg)
+{
+	struct sim_event ev = {
+		.tick = ctx->ticks,
+		.pid = pid,
+		.arg = arg,
+		.cpu = cpu,
+		.type = type,
+	};
+
+	if (ctx->__chrome) sim_chrome_append(ctx->__chrome, &ev);
+
+	if (ctx->__events) {
+		sim_event_log_append(ctx->__events, &ev);
+	} else if (ctx->trace) {
+		sim_render_event(ctx->trace, ctx->nr_cpus, &ev);
+	}
+}
+
+/**
+ * Log the priority of @p if it has changed since logged last. Schedulers
+ * change priorities on acquiring and releasing resources (e.g., PIP and PCP)
+ */
+static void __trace_prio(struct sim_context *ctx, struct process *p)
+{
+	if (!p || p->prio == p->__traced_prio) return;
+
+	p->__traced_prio = p->prio;
+	__trace_event(ctx, p->cpu, p->pid, SIM_EVENT_PRIO, p->prio);
+}
 
 static inline bool strmatch(char * const str, const char *expect)
 {
 	return (strlen(str) == strlen(expect)) && (strncmp(str, expect, strlen(expect)) == 0);
 }
 
-static void __briefing_process(struct process *p)
+static void __briefing_process(struct sim_context *ctx, struct process *p, int nr_jobs)
 {
 	struct resource_schedule *rs;
 
-	if (quiet) return;
+	if (ctx->quiet) return;
 
 	printf("- Process %d: Forked at tick %d and run for %d tick%s with initial priority %d\n",
 				p->pid, p->__starts_at, p->lifespan,
 				p->lifespan >= 2 ? "s" : "", p->prio);
 
+	if (p->deadline) {
+		printf("    Due in %d ticks", p->deadline - p->__starts_at);
+		if (p->period) {
+			printf(", and released every %d ticks for %d job%s",
+					p->period, nr_jobs, nr_jobs >= 2 ? "s" : "");
+		}
+		printf("\n");
+	}
+
 	list_for_each_entry(rs, &p->__resources_to_acquire, list) {
-		printf("    Acquire resource %d at %d for %d\n", rs->resource_id, rs->at, rs->duration);
+		printf("    Acquire resource %d at %d for %d%s\n", rs->resource_id,
+				rs->at, rs->duration, rs->shared ? " (shared)" : "");
+	}
+	list_for_each_entry(rs, &p->__io_to_issue, list) {
+		printf("    I/O on device %d at %d for %d\n", rs->resource_id, rs->at, rs->duration);
+	}
+}
+
+/**
+ * Keep @schedules (i.e., @p->__resources_to_acquire and @p->__io_to_issue)
+ * sorted by the age to acquire or to issue so that the next one is always
+ * at the head. Schedules at the same age are kept in the script order.
+ */
+static void __add_schedule(struct list_head *schedules, struct resource_schedule *rs)
+{
+	struct list_head *pos = schedules->prev;
+
+	while (pos != schedules &&
+			list_entry(pos, struct resource_schedule, list)->at > rs->at) {
+		pos = pos->prev;
+	}
+	list_add(&rs->list, pos);
+}
+
+static void __init_process(struct process *p)
+{
+	INIT_LIST_HEAD(&p->list);
+	INIT_PQ_NODE(&p->pq);
+	INIT_PQ_NODE(&p->waiting);
+	p->waiting_on = -1;
+	INIT_LIST_HEAD(&p->holding);
+	INIT_LIST_HEAD(&p->__resources_to_acquire);
+	pq_init(&p->__resources_releasing);
+	INIT_LIST_HEAD(&p->__io_to_issue);
+}
+
+static bool __copy_schedules(struct sim_context *ctx,
+		struct list_head *to, struct list_head *from)
+{
+	struct resource_schedule *rs;
+
+	list_for_each_entry(rs, from, list) {
+		struct resource_schedule *copy = sim_pool_alloc(&ctx->__schedules);
+
+		if (!copy) return false;
+
+		*copy = *rs;
+		INIT_PQ_NODE(&copy->pq);
+		list_add_tail(&copy->list, to);
+	}
+	return true;
+}
+
+/**
+ * Clone @p into the @job-th job of the periodic process. Return NULL if out
+ * of memory
+ */
+static struct process *__clone_job(struct sim_context *ctx,
+		struct process *p, unsigned int job)
+{
+	struct process *clone = sim_pool_alloc(&ctx->__processes);
+
+	if (!clone) return NULL;
+
+	memcpy(clone, p, sizeof(*clone));
+	__init_process(clone);
+
+	if (!__copy_schedules(ctx, &clone->__resources_to_acquire, &p->__resources_to_acquire) ||
+			!__copy_schedules(ctx, &clone->__io_to_issue, &p->__io_to_issue)) {
+		return NULL;
+	}
+
+	clone->__job = job;
+	clone->__starts_at += job * p->period;
+	if (clone->deadline) {
+		clone->deadline += job * p->period;
+		clone->deadline_orig = clone->deadline;
+	}
+	return clone;
+}
+
+/**
+ * Make the resource table have resource @resource_id, growing it twice at
+ * least. The resources are moved to the new table, so their list heads are
+ * relinked from the old places. Return false if out of memory
+ */
+static bool __reserve_resource(struct sim_context *ctx, unsigned int resource_id)
+{
+	struct resource *resources;
+	unsigned int nr = ctx->nr_resources * 2;
+
+	if (resource_id < ctx->nr_resources) return true;
+
+	if (nr <= resource_id) nr = resource_id + 1;
+	if (nr > MAX_RESOURCES) nr = MAX_RESOURCES;
+
+	resources = malloc(sizeof(*resources) * nr);
+	if (!resources) return false;
+
+	for (unsigned int i = 0; i < ctx->nr_resources; i++) {
+		struct resource *r = resources + i;
+		struct resource *old = ctx->resources + i;
+
+		*r = *old;
+		if (list_empty(&old->holders)) {
+			INIT_LIST_HEAD(&r->holders);
+		} else {
+			list_replace(&old->holders, &r->holders);
+		}
+		if (list_empty(&old->waitqueue)) {
+			INIT_LIST_HEAD(&r->waitqueue);
+		} else {
+			list_replace(&old->waitqueue, &r->waitqueue);
+		}
+	}
+	for (unsigned int i = ctx->nr_resources; i < nr; i++) {
+		struct resource *r = resources + i;
+
+		r->units = 1;
+		INIT_LIST_HEAD(&r->holders);
+		r->nr_exclusive = 0;
+		r->nr_shared = 0;
+		INIT_LIST_HEAD(&r->waitqueue);
+		pq_init(&r->waiters);
+		r->owner = NULL;
+		r->__blocked = 0;
 	}
+
+	free(ctx->resources);
+	ctx->resources = resources;
+	ctx->nr_resources = nr;
+	return true;
 }
 
-static int __load_script(char * const filename)
+/**
+ * Queue @p to fork at its start. A process streamed in after its start
+ * forks right away, but still counts the time from the start
+ */
+static void __queue_fork(struct sim_context *ctx, struct process *p)
+{
+	pq_push(&ctx->__forkqueue, &p->pq,
+			p->__starts_at > ctx->ticks ? p->__starts_at : ctx->ticks);
+}
+
+enum script_item {
+	SCRIPT_EOF,
+	SCRIPT_PROCESS,	/* A process is queued to fork at @*tick */
+	SCRIPT_TICK,	/* No process will start before @*tick */
+	SCRIPT_ERROR,
+};
+
+/**
+ * Read the next item of the process script in @file. Besides the process
+ * descriptions, a script can have "tick N" lines between them to tell that
+ * no more process starts before tick N, which matters only for streaming
+ */
+static enum script_item __read_script(struct sim_context *ctx, FILE *file,
+		unsigned int *tick)
 {
 	char line[256];
 	struct process *p = NULL;
+	int nr_jobs = 1;
 
-	FILE *file = fopen(filename, "r");
 	while (fgets(line, sizeof(line), file)) {
 		char *tokens[32] = { NULL };
 		int nr_tokens;
@@ -171,240 +474,1500 @@ static int __load_script(char * const filename)
 		if (strmatch(tokens[0], "process")) {
 			assert(nr_tokens == 2);
 			/* Start processor description */
-			p = malloc(sizeof(*p));
+			p = sim_pool_alloc(&ctx->__processes);
+			if (!p) goto out_nomem;
 			memset(p, 0x00, sizeof(*p));
 
 			p->pid = atoi(tokens[1]);
+			p->__first_run = UINT_MAX;
+			__init_process(p);
+			nr_jobs = 1;
 
-			INIT_LIST_HEAD(&p->list);
-			INIT_LIST_HEAD(&p->__resources_to_acquire);
-			INIT_LIST_HEAD(&p->__resources_holding);
-
+			continue;
+		} else if (strmatch(tokens[0], "tick") && !p) {
+			assert(nr_tokens == 2);
+			*tick = atoi(tokens[1]);
+			return SCRIPT_TICK;
+		} else if (strmatch(tokens[0], "device") && !p) {
+			int device;
+			assert(nr_tokens == 3);
+
+			device = atoi(tokens[1]);
+			if (device < 0 || device >= NR_DEVICES) {
+				fprintf(stderr, "Invalid device %s\n", tokens[1]);
+				return SCRIPT_ERROR;
+			}
+			if (strmatch(tokens[2], "fcfs")) {
+				ctx->devices[device].policy = SIM_DEVICE_FCFS;
+			} else if (strmatch(tokens[2], "prio")) {
+				ctx->devices[device].policy = SIM_DEVICE_PRIO;
+			} else {
+				fprintf(stderr, "Unknown device policy %s\n", tokens[2]);
+				return SCRIPT_ERROR;
+			}
+			continue;
+		} else if (strmatch(tokens[0], "resource") && !p) {
+			int resource_id;
+			int units;
+			assert(nr_tokens == 3);
+
+			resource_id = atoi(tokens[1]);
+			units = atoi(tokens[2]);
+			if (resource_id < 0 || resource_id >= MAX_RESOURCES || units <= 0) {
+				fprintf(stderr, "Invalid resource %s of %s units\n", tokens[1], tokens[2]);
+				return SCRIPT_ERROR;
+			}
+			if (!__reserve_resource(ctx, resource_id)) {
+				fprintf(stderr, "Cannot allocate resource %d\n", resource_id);
+				return SCRIPT_ERROR;
+			}
+			ctx->resources[resource_id].units = units;
 			continue;
 		} else if (strmatch(tokens[0], "end")) {
 			/* End of process description */
-			struct resource_schedule *rs;
 			assert(p);
+			assert(nr_jobs == 1 || p->period);
 
-			list_add_tail(&p->list, &__forkqueue);
+			/* Implicit deadline for periodic processes */
+			if (!p->deadline) p->deadline = p->period;
+			if (p->deadline) p->deadline += p->__starts_at;
+			p->deadline_orig = p->deadline;
 
-			__briefing_process(p);
-			p = NULL;
+			for (int i = 1; i < nr_jobs; i++) {
+				struct process *clone = __clone_job(ctx, p, i);
 
-			continue;
+				if (!clone) goto out_nomem;
+				__queue_fork(ctx, clone);
+			}
+			__queue_fork(ctx, p);
+
+			__briefing_process(ctx, p, nr_jobs);
+			*tick = p->__starts_at;
+			return SCRIPT_PROCESS;
 		}
 
 		if (strmatch(tokens[0], "lifespan")) {
 			assert(nr_tokens == 2);
 			p->lifespan = atoi(tokens[1]);
 		} else if (strmatch(tokens[0], "prio")) {
+			int prio;
 			assert(nr_tokens == 2);
-			p->prio = p->prio_orig = atoi(tokens[1]);
+
+			prio = atoi(tokens[1]);
+			if (prio < 0 || prio > MAX_PRIO) {
+				fprintf(stderr, "Invalid priority %s\n", tokens[1]);
+				return SCRIPT_ERROR;
+			}
+			p->prio = p->prio_orig = prio;
 		} else if (strmatch(tokens[0], "start")) {
 			assert(nr_tokens == 2);
 			p->__starts_at = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "acquire")) {
+		} else if (strmatch(tokens[0], "deadline")) {
+			assert(nr_tokens == 2);
+			p->deadline = atoi(tokens[1]);	/* Relative until the end */
+		} else if (strmatch(tokens[0], "period")) {
+			assert(nr_tokens == 2);
+			p->period = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "jobs")) {
+			assert(nr_tokens == 2);
+			nr_jobs = atoi(tokens[1]);
+		} else if (strmatch(tokens[0], "acquire") ||
+				strmatch(tokens[0], "acquire-shared")) {
 			struct resource_schedule *rs;
 			assert(nr_tokens == 4);
 
-			rs = malloc(sizeof(*rs));
+			rs = sim_pool_alloc(&ctx->__schedules);
+			if (!rs) goto out_nomem;
 
 			rs->resource_id = atoi(tokens[1]);
 			rs->at = atoi(tokens[2]);
 			rs->duration = atoi(tokens[3]);
+			rs->shared = strmatch(tokens[0], "acquire-shared");
+			INIT_PQ_NODE(&rs->pq);
+
+			if (rs->resource_id < 0 || rs->resource_id >= MAX_RESOURCES ||
+					!__reserve_resource(ctx, rs->resource_id)) {
+				fprintf(stderr, "Invalid resource %d\n", rs->resource_id);
+				return SCRIPT_ERROR;
+			}
+			__add_schedule(&p->__resources_to_acquire, rs);
+		} else if (strmatch(tokens[0], "io")) {
+			struct resource_schedule *rs;
+			assert(nr_tokens == 3 || nr_tokens == 4);
+
+			rs = sim_pool_alloc(&ctx->__schedules);
+			if (!rs) goto out_nomem;
 
-			list_add_tail(&rs->list, &p->__resources_to_acquire);
+			rs->resource_id = nr_tokens == 4 ? atoi(tokens[3]) : 0;
+			rs->at = atoi(tokens[1]);
+			rs->duration = atoi(tokens[2]);
+			rs->shared = false;
+			INIT_PQ_NODE(&rs->pq);
+
+			if (rs->resource_id < 0 || rs->resource_id >= NR_DEVICES) {
+				fprintf(stderr, "Invalid device %d\n", rs->resource_id);
+				return SCRIPT_ERROR;
+			}
+			__add_schedule(&p->__io_to_issue, rs);
 		} else {
 			fprintf(stderr, "Unknown property %s\n", tokens[0]);
-			return false;
+			return SCRIPT_ERROR;
 		}
 	}
-	fclose(file);
-	if (!quiet) printf("\n");
-	return true;
-}
+	return SCRIPT_EOF;
 
+out_nomem:
+	fprintf(stderr, "Out of memory\n");
+	return SCRIPT_ERROR;
+}
 
-/**
- * Fork process on schedule
- */
-static int __fork_on_schedule()
+static bool __load_script(struct sim_context *ctx, FILE *file)
 {
-	int nr_forked = 0;
-	struct process *p, *tmp;
-	list_for_each_entry_safe(p, tmp, &__forkqueue, list) {
-		if (p->__starts_at <= ticks) {
-			list_move_tail(&p->list, &readyqueue);
-			p->status = PROCESS_READY;
-			__print_event(p->pid, "N");
-			if (sched->forked) sched->forked(p);
-			nr_forked++;
-		}
+	enum script_item item;
+	unsigned int tick;
+
+	while ((item = __read_script(ctx, file, &tick)) != SCRIPT_EOF) {
+		if (item == SCRIPT_ERROR) return false;
 	}
-	return nr_forked;
+	return true;
 }
 
 /**
- * Exit the process
+ * Load the binary workload mapped at @map of @size bytes. All the jobs and
+ * their acquire schedules are carved out of a single chunk of each pool
  */
-static void __exit_process(struct process *p)
+static bool __load_workload(struct sim_context *ctx, const void *map, size_t size)
 {
-	/* Make sure the process is not attached to some list head */
-	assert(list_empty(&p->list));
+	const struct sim_workload_header *header = map;
+	const struct sim_workload_process *wps;
+	const struct sim_workload_acquire *was;
+	const struct sim_workload_resource *wrs;
+	size_t nr_processes = 0, nr_schedules = 0;
+	struct process *p;
+	struct resource_schedule *rs;
 
-	/* Make sure the process is not holding any resource */
-	assert(list_empty(&p->__resources_holding));
+	if (header->version != SIM_WORKLOAD_VERSION) {
+		fprintf(stderr, "Unsupported workload version %u\n", header->version);
+		return false;
+	}
+	if (size < sizeof(*header) +
+			(size_t)header->nr_processes * sizeof(*wps) +
+			(size_t)header->nr_acquires * sizeof(*was) +
+			(size_t)header->nr_resources * sizeof(*wrs)) {
+		fprintf(stderr, "Truncated workload\n");
+		return false;
+	}
+	wps = (const void *)(header + 1);
+	was = (const void *)(wps + header->nr_processes);
+	wrs = (const void *)(was + header->nr_acquires);
+
+	for (uint32_t i = 0; i < header->nr_resources; i++) {
+		if (wrs[i].resource >= MAX_RESOURCES || !wrs[i].units ||
+				!__reserve_resource(ctx, wrs[i].resource)) {
+			fprintf(stderr, "Invalid resource %u in the workload\n", wrs[i].resource);
+			return false;
+		}
+		ctx->resources[wrs[i].resource].units = wrs[i].units;
+	}
 
-	/* Make sure there is no pending resource to acquire */
-	assert(list_empty(&p->__resources_to_acquire));
+	for (uint32_t i = 0; i < header->nr_processes; i++) {
+		const struct sim_workload_process *wp = wps + i;
+
+		if (!wp->nr_jobs || (wp->nr_jobs > 1 && !wp->period) ||
+				wp->prio > MAX_PRIO ||
+				wp->first_acquire > header->nr_acquires ||
+				wp->nr_acquires > header->nr_acquires - wp->first_acquire) {
+			fprintf(stderr, "Corrupted process %u in the workload\n", wp->pid);
+			return false;
+		}
+		for (uint32_t j = 0; j < wp->nr_acquires; j++) {
+			uint32_t resource = was[wp->first_acquire + j].resource;
+
+			if ((resource & SIM_WORKLOAD_IO) ?
+					(resource & ~SIM_WORKLOAD_IO) >= NR_DEVICES :
+					(resource & ~SIM_WORKLOAD_SHARED) >= MAX_RESOURCES ||
+					!__reserve_resource(ctx, resource & ~SIM_WORKLOAD_SHARED)) {
+				fprintf(stderr, "Corrupted process %u in the workload\n", wp->pid);
+				return false;
+			}
+		}
+		nr_processes += wp->nr_jobs;
+		nr_schedules += (size_t)wp->nr_jobs * wp->nr_acquires;
+	}
 
-	if (sched->exiting) sched->exiting(p);
+	if (!sim_pool_reserve(&ctx->__processes, nr_processes) ||
+			!sim_pool_reserve(&ctx->__schedules, nr_schedules)) {
+		fprintf(stderr, "Cannot allocate %zu processes for the workload\n",
+				nr_processes);
+		return false;
+	}
 
-	__print_event(p->pid, "X");
+	for (int i = 0; i < NR_DEVICES; i++) {
+		if (header->prio_devices & (1U << i)) {
+			ctx->devices[i].policy = SIM_DEVICE_PRIO;
+		}
+	}
 
-	free(p);
-}
+	for (uint32_t i = 0; i < header->nr_processes; i++) {
+		const struct sim_workload_process *wp = wps + i;
 
+		for (uint32_t job = 0; job < wp->nr_jobs; job++) {
+			p = sim_pool_alloc(&ctx->__processes);
+			if (!p) goto out_nomem;
+			memset(p, 0x00, sizeof(*p));
 
-/**
- * Process resource acqutision
- */
-static bool __run_current_acquire()
+			p->pid = wp->pid;
+			p->lifespan = wp->lifespan;
+			p->prio = p->prio_orig = wp->prio;
+			p->period = wp->period;
+			p->__job = job;
+			p->__starts_at = wp->start + job * wp->period;
+			p->__first_run = UINT_MAX;
+
+			/* Implicit deadline for periodic processes */
+			p->deadline = wp->deadline ? wp->deadline : wp->period;
+			if (p->deadline) p->deadline += p->__starts_at;
+			p->deadline_orig = p->deadline;
+
+			__init_process(p);
+
+			for (uint32_t j = 0; j < wp->nr_acquires; j++) {
+				const struct sim_workload_acquire *wa = was + wp->first_acquire + j;
+
+				rs = sim_pool_alloc(&ctx->__schedules);
+				if (!rs) goto out_nomem;
+				rs->resource_id = wa->resource &
+						~(SIM_WORKLOAD_IO | SIM_WORKLOAD_SHARED);
+				rs->shared = !(wa->resource & SIM_WORKLOAD_IO) &&
+						(wa->resource & SIM_WORKLOAD_SHARED);
+				rs->at = wa->at;
+				rs->duration = wa->duration;
+				INIT_PQ_NODE(&rs->pq);
+
+				__add_schedule(wa->resource & SIM_WORKLOAD_IO ?
+						&p->__io_to_issue : &p->__resources_to_acquire, rs);
+			}
+			__queue_fork(ctx, p);
+
+			if (job == 0) __briefing_process(ctx, p, wp->nr_jobs);
+		}
+	}
+	return true;
+
+out_nomem:
+	fprintf(stderr, "Out of memory\n");
+	return false;
+}
+
+bool sim_load_script(struct sim_context *ctx, char * const filename)
 {
-	struct resource_schedule *rs, *tmp;
+	uint32_t magic = 0;
+	bool loaded;
 
-	list_for_each_entry_safe(rs, tmp, &current->__resources_to_acquire, list) {
-		if (rs->at == current->age) {
-			assert(sched->acquire && "scheduler.acquire() not implemented");
+	FILE *file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return false;
+	}
 
-			/* Callback to acquire the resource */
-			if (sched->acquire(rs->resource_id)) {
-				list_move_tail(&rs->list, &current->__resources_holding);
+	if (fread(&magic, sizeof(magic), 1, file) == 1 &&
+			magic == SIM_WORKLOAD_MAGIC) {
+		struct stat st;
+		void *map;
 
-				__print_event(current->pid, "+%d", rs->resource_id);
-			} else {
-				return false;
-			}
+		if (fstat(fileno(file), &st) ||
+				(map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+						fileno(file), 0)) == MAP_FAILED) {
+			fprintf(stderr, "Cannot map %s\n", filename);
+			fclose(file);
+			return false;
 		}
+		loaded = st.st_size >= sizeof(struct sim_workload_header) &&
+				__load_workload(ctx, map, st.st_size);
+		munmap(map, st.st_size);
+	} else {
+		rewind(file);
+		loaded = __load_script(ctx, file);
 	}
+	fclose(file);
 
-	return true;
+	if (loaded && !ctx->quiet) printf("\n");
+	return loaded;
 }
 
-/**
- * Process resource release
- */
-static void __run_current_release()
+bool sim_stream_script(struct sim_context *ctx, char * const filename)
 {
-	struct resource_schedule *rs, *tmp;
+	FILE *file = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "r");
 
-	list_for_each_entry_safe(rs, tmp, &current->__resources_holding, list) {
-		if (--rs->duration == 0) {
-			assert(sched->release && "scheduler.release() not implemented");
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", filename);
+		return false;
+	}
+	ctx->__stream = file;
+	ctx->__stream_until = 0;
+	return true;
+}
 
-			/* Callback the release() */
-			sched->release(rs->resource_id);
+static void __close_stream(struct sim_context *ctx)
+{
+	if (ctx->__stream != stdin) fclose(ctx->__stream);
+	ctx->__stream = NULL;
+}
 
-			__print_event(current->pid, "-%d", rs->resource_id);
+/**
+ * Read the streamed script until a process starting after the current
+ * tick, so that every process to fork by now is in the fork queue. This
+ * blocks the simulation until the writer catches up with the simulated
+ * time, and the writer in turn blocks on the full pipe when it runs ahead.
+ * The processes should be streamed in the order of their start
+ */
+static void __pull_stream(struct sim_context *ctx)
+{
+	unsigned int tick;
 
-			list_del(&rs->list);
-			free(rs);
+	while (ctx->__stream && ctx->__stream_until <= ctx->ticks) {
+		switch (__read_script(ctx, ctx->__stream, &tick)) {
+		case SCRIPT_PROCESS:
+		case SCRIPT_TICK:
+			if (tick > ctx->__stream_until) ctx->__stream_until = tick;
+			break;
+		case SCRIPT_ERROR:
+			fprintf(stderr, "Stop streaming at tick %u\n", ctx->ticks);
+			/* fall through */
+		case SCRIPT_EOF:
+			__close_stream(ctx);
+			break;
 		}
 	}
 }
 
 
 /***********************************************************************
- * The main loop for the scheduler simulation
+ * Multi-processor support
+ *
+ * DESCRIPTION
+ *   Only one CPU is loaded in the context at a time. __load_cpu() saves the
+ *   current, the ready queue, and the scheduler data of the loaded CPU into
+ *   @ctx->cpus, and loads those of @cpu into the context.
  */
-static void __do_simulation(void)
+static void __load_cpu(struct sim_context *ctx, unsigned int cpu)
 {
-	assert(sched->schedule && "scheduler.schedule() not implemented");
+	struct sim_cpu *prev = ctx->cpus + ctx->cpu;
+	struct sim_cpu *next = ctx->cpus + cpu;
 
-	while (true) {
-		struct process *prev;
+	if (cpu == ctx->cpu) return;
 
-		/* Fork processes on schedule */
-		__fork_on_schedule();
+	prev->current = ctx->current;
+	list_splice_init(&ctx->readyqueue, &prev->readyqueue);
+	prev->sched_data = ctx->sched_data;
 
-		/* Ask scheduler to pick the next process to run */
-		prev = current;
-		current = sched->schedule();
+	ctx->current = next->current;
+	list_splice_init(&next->readyqueue, &ctx->readyqueue);
+	ctx->sched_data = next->sched_data;
 
-		/* If the system ran a process in the previous tick, */
-		if (prev) {
-			/* Update the process status */
-			if (prev->status == PROCESS_RUNNING) {
-				prev->status = PROCESS_READY;
-			}
+	ctx->cpu = cpu;
+}
 
-			/* Decommission it if completed */
-			if (prev->age == prev->lifespan) {
-				prev->status = PROCESS_EXIT;
-				__exit_process(prev);
-			}
-		}
+struct process *sim_current_of(struct sim_context *ctx, unsigned int cpu)
+{
+	if (!ctx->cpus || cpu == ctx->cpu) return ctx->current;
+	return ctx->cpus[cpu].current;
+}
 
-		/* No process is ready to run at this moment */
-		if (!current) {
-			/* Quit simulation if no pending process exists */
-			if (list_empty(&readyqueue) && list_empty(&__forkqueue)) {
-				break;
-			}
+struct list_head *sim_readyqueue_of(struct sim_context *ctx, unsigned int cpu)
+{
+	if (!ctx->cpus || cpu == ctx->cpu) return &ctx->readyqueue;
+	return &ctx->cpus[cpu].readyqueue;
+}
 
-			/* Idle temporarily */
-			fprintf(stderr, "%3d: idle\n", ticks);
-			goto next;
-		}
+void *sim_sched_data_of(struct sim_context *ctx, unsigned int cpu)
+{
+	if (!ctx->cpus || cpu == ctx->cpu) return ctx->sched_data;
+	return ctx->cpus[cpu].sched_data;
+}
 
-		/* Execute the current process */
-		current->status = PROCESS_RUNNING;
+bool sim_migrate(struct sim_context *ctx, unsigned int src, unsigned int dst)
+{
+	unsigned int cpu = ctx->cpu;
+	struct process *p = NULL;
 
-		/* Ensure that @current is detached from any list */
-		assert(list_empty(&current->list));
+	if (src == dst) return false;
 
-		/* Try acquiring scheduled resources */
-		if (__run_current_acquire()) {
-			/* Succesfully acquired all the resources to make a progress! */
-			__print_event(current->pid, "%d", current->pid);
+	__load_cpu(ctx, src);
+	if (ctx->sched->migrate) {
+		p = ctx->sched->migrate(ctx);
+	} else if (!list_empty(&ctx->readyqueue)) {
+		p = list_last_entry(&ctx->readyqueue, struct process, list);
+		list_del_init(&p->list);
+	}
 
-			/* So, it ages by one tick */
-			current->age++;
+	if (p) {
+		assert(p != ctx->current && p->status == PROCESS_READY);
+		assert(list_empty(&p->list));
+		ctx->cpus[src].nr_running--;
+
+		__load_cpu(ctx, dst);
+		list_add_tail(&p->list, &ctx->readyqueue);
+		p->cpu = dst;
+		ctx->cpus[dst].nr_running++;
+		ctx->cpus[dst].nr_migrations++;
+		__trace_event(ctx, ctx->cpu, p->pid, SIM_EVENT_MIGRATE, 0);
+	}
 
-			/* And performs scheduled releases */
-			__run_current_release();
-		} else {
+	__load_cpu(ctx, cpu);
+	return p != NULL;
+}
+
+/**
+ * Account the ticks @p has been blocked, from the tick it failed to acquire
+ * to this tick, as it is woken up (or killed)
+ */
+static void __account_unblocking(struct sim_context *ctx, struct process *p)
+{
+	unsigned int blocked = ctx->ticks + 1 - p->__blocked_at;
+
+	p->__blocked += blocked;
+	ctx->resources[p->__blocked_on].__blocked += blocked;
+
+	if (p->__inverted) {
+		p->__inversion += blocked;
+		if (blocked > ctx->__max_inversion) {
+			ctx->__max_inversion = blocked;
+		}
+		p->__inverted = false;
+	}
+}
+
+/**
+ * Account the processes that are woken up into the ready queue of the
+ * loaded CPU after @tail. They might have been on other CPUs before
+ */
+static void __account_wakeups(struct sim_context *ctx, struct list_head *tail)
+{
+	struct sim_cpu *cpu = ctx->cpus + ctx->cpu;
+
+	for (struct list_head *pos = tail->next; pos != &ctx->readyqueue; pos = pos->next) {
+		struct process *p = list_entry(pos, struct process, list);
+
+		__account_unblocking(ctx, p);
+
+		cpu->nr_running++;
+		if (p->cpu != ctx->cpu) {
 			/**
-			 * The current is blocked while acquiring resource(s).
-			 * In this case, @current could not make a progress in this tick
+			 * It was blocked as the current of the other CPU, which
+			 * has not been scheduled since then. Take it away
 			 */
-			__print_event(current->pid, "=");
+			if (ctx->cpus[p->cpu].current == p) {
+				ctx->cpus[p->cpu].current = NULL;
+			}
+			cpu->nr_migrations++;
+			p->cpu = ctx->cpu;
+		}
+		__trace_prio(ctx, p);
+	}
+}
+
+/**
+ * Forked processes go to the CPU running the least number of processes
+ */
+static unsigned int __least_loaded_cpu(struct sim_context *ctx)
+{
+	unsigned int target = 0;
 
-			/* Thus, it is not get aged nor unable to perform releases */
+	for (unsigned int cpu = 1; cpu < ctx->nr_cpus; cpu++) {
+		if (ctx->cpus[cpu].nr_running < ctx->cpus[target].nr_running) {
+			target = cpu;
 		}
+	}
+	return target;
+}
 
-next:
-		/* Increase the tick counter */
-		ticks++;
+
+/***********************************************************************
+ * I/O devices
+ *
+ * DESCRIPTION
+ *   A process issues the I/O scheduled at its age right after making the
+ *   progress to the age (or on the fork for the I/O at age 0), and leaves
+ *   its CPU until the I/O completes. Devices are run at the beginning of
+ *   each tick, before the CPUs; the I/O served to the end wakes up its
+ *   process into the ready queue, and the device starts serving the next
+ *   request in the queue.
+ */
+static void __issue_io(struct sim_context *ctx, struct process *p, unsigned int at)
+{
+	struct resource_schedule *rs =
+			list_first_entry(&p->__io_to_issue, struct resource_schedule, list);
+	struct sim_device *dev = ctx->devices + rs->resource_id;
+	struct list_head *pos = dev->queue.prev;
+
+	p->status = PROCESS_WAIT;
+	p->__io_device = rs->resource_id;
+	p->__io_duration = rs->duration ? rs->duration : 1;
+	p->__io_at = at;
+
+	list_del(&rs->list);
+	sim_pool_free(&ctx->__schedules, rs);
+
+	/* Behind the requests of higher or the same priority */
+	if (dev->policy == SIM_DEVICE_PRIO) {
+		while (pos != &dev->queue &&
+				list_entry(pos, struct process, list)->prio < p->prio) {
+			pos = pos->prev;
+		}
+	}
+	list_add(&p->list, pos);
+
+	ctx->cpus[p->cpu].nr_running--;
+	__trace_event(ctx, p->cpu, p->pid, SIM_EVENT_IO, p->__io_device);
+}
+
+/**
+ * Issue the I/O scheduled at the age the current has just made
+ */
+static bool __run_current_io(struct sim_context *ctx)
+{
+	struct process *current = ctx->current;
+	struct resource_schedule *rs;
+
+	if (list_empty(&current->__io_to_issue) ||
+			current->age >= current->lifespan) return false;
+
+	rs = list_first_entry(&current->__io_to_issue, struct resource_schedule, list);
+	if (rs->at != current->age) return false;
+
+	/* It is off the CPU from the next tick */
+	__issue_io(ctx, current, ctx->ticks + 1);
+	return true;
+}
+
+static void __run_devices(struct sim_context *ctx)
+{
+	for (int i = 0; i < NR_DEVICES; i++) {
+		struct sim_device *dev = ctx->devices + i;
+		struct process *p = dev->serving;
+
+		if (p && dev->done_at <= ctx->ticks) {
+			dev->serving = NULL;
+
+			__load_cpu(ctx, p->cpu);
+			list_add_tail(&p->list, &ctx->readyqueue);
+			p->status = PROCESS_READY;
+			p->__io += ctx->ticks - p->__io_at;
+			ctx->cpus[p->cpu].nr_running++;
+
+			__trace_event(ctx, p->cpu, p->pid, SIM_EVENT_IO_DONE, i);
+		}
+
+		if (!dev->serving && !list_empty(&dev->queue)) {
+			p = list_first_entry(&dev->queue, struct process, list);
+			list_del_init(&p->list);
+
+			dev->serving = p;
+			dev->done_at = ctx->ticks + p->__io_duration;
+			dev->nr_requests++;
+		}
+	}
+}
+
+/**
+ * Count @nr_ticks ticks to the devices serving an I/O. The ticks never go
+ * beyond the completion, which ends the ticks to skip
+ */
+static void __account_devices(struct sim_context *ctx, unsigned int nr_ticks)
+{
+	for (int i = 0; i < NR_DEVICES; i++) {
+		if (ctx->devices[i].serving) ctx->devices[i].nr_busy += nr_ticks;
+	}
+}
+
+/**
+ * When the devices need to be run next. UINT_MAX if no I/O is in flight
+ */
+static unsigned int __next_io_at(struct sim_context *ctx)
+{
+	unsigned int next = UINT_MAX;
+
+	for (int i = 0; i < NR_DEVICES; i++) {
+		struct sim_device *dev = ctx->devices + i;
+
+		if (dev->serving) {
+			if (dev->done_at < next) next = dev->done_at;
+		} else if (!list_empty(&dev->queue)) {
+			return ctx->ticks;
+		}
 	}
+	return next;
 }
 
 
-static void __initialize(void)
+/**
+ * Fork process on schedule
+ */
+static int __fork_on_schedule(struct sim_context *ctx)
+{
+	int nr_forked = 0;
+	struct pq_node *node;
+
+	while ((node = pq_peek(&ctx->__forkqueue)) && node->key <= ctx->ticks) {
+		struct process *p = pq_entry(node, struct process, pq);
+
+		pq_remove(&ctx->__forkqueue, node);
+
+		__load_cpu(ctx, __least_loaded_cpu(ctx));
+		p->cpu = ctx->cpu;
+		ctx->cpus[ctx->cpu].nr_running++;
+
+		list_add_tail(&p->list, &ctx->readyqueue);
+		p->status = PROCESS_READY;
+		__trace_event(ctx, ctx->cpu, p->pid, SIM_EVENT_FORK, 0);
+
+		p->__traced_prio = p->prio;
+		__trace_event(ctx, ctx->cpu, p->pid, SIM_EVENT_PRIO, p->prio);
+		list_add_tail(&p->__forked, &ctx->__forked);
+		if (ctx->sched->forked) ctx->sched->forked(ctx, p);
+		nr_forked++;
+
+		/* Starts with an I/O before running at all */
+		if (!list_empty(&p->__io_to_issue) && p->lifespan &&
+				list_first_entry(&p->__io_to_issue,
+						struct resource_schedule, list)->at == 0) {
+			list_del_init(&p->list);
+			__issue_io(ctx, p, ctx->ticks);
+		}
+	}
+	return nr_forked;
+}
+
+static void __free_schedules(struct sim_context *ctx, struct list_head *schedules)
 {
-	INIT_LIST_HEAD(&readyqueue);
+	struct resource_schedule *rs, *tmp;
 
-	for (int i = 0; i < NR_RESOURCES; i++) {
-		resources[i].owner = NULL;
-		INIT_LIST_HEAD(&(resources[i].waitqueue));
+	list_for_each_entry_safe(rs, tmp, schedules, list) {
+		list_del(&rs->list);
+		sim_pool_free(&ctx->__schedules, rs);
 	}
+}
+
+/**
+ * Exit the process
+ */
+static void __exit_process(struct sim_context *ctx, struct process *p)
+{
+	struct sim_record *rec;
+
+	/* Make sure the process is not attached to some list head */
+	assert(list_empty(&p->list));
+
+	/* Make sure the process is not holding any resource */
+	assert(list_empty(&p->holding));
+
+	/* Make sure there is no pending resource to acquire */
+	assert(list_empty(&p->__resources_to_acquire));
 
-	INIT_LIST_HEAD(&__forkqueue);
+	pq_destroy(&p->__resources_releasing);
+	ctx->cpus[p->cpu].nr_running--;
 
-	if (quiet) return;
+	/* I/Os scheduled at or beyond the lifespan are never issued */
+	__free_schedules(ctx, &p->__io_to_issue);
+
+	rec = malloc(sizeof(*rec));
+	assert(rec);
+
+	rec->pid = p->pid;
+	rec->job = p->__job;
+	rec->arrival = p->__starts_at;
+	rec->first_run = p->__first_run;
+	rec->finish = ctx->ticks;
+	rec->lifespan = p->age;
+	rec->killed = p->age < p->lifespan;
+	rec->deadline = p->deadline_orig;
+	rec->blocked = p->__blocked;
+	rec->inversion = p->__inversion;
+	rec->chain = p->__chain;
+	rec->io = p->__io;
+	list_add_tail(&rec->list, &ctx->records);
+
+	if (ctx->sched->exiting) ctx->sched->exiting(ctx, p);
+	list_del(&p->__forked);
+
+	__trace_event(ctx, ctx->cpu, p->pid, SIM_EVENT_EXIT, 0);
+
+	sim_pool_free(&ctx->__processes, p);
+}
+
+
+/***********************************************************************
+ * Wait-for graph
+ *
+ * DESCRIPTION
+ *   A process waiting for a resource waits for all the holders of the
+ *   resource, each of which may be waiting for another resource in turn.
+ *   A walk of the graph from the current visits each process once, as told
+ *   by @__walk of the process, and does not go beyond the current.
+ */
+
+/**
+ * Walk the processes blocking the current through the holders of
+ * @resource_id. Return the length of the longest blocking chain from there
+ */
+static unsigned int __walk_blockers(struct sim_context *ctx, int resource_id)
+{
+	struct process *current = ctx->current;
+	struct resource_hold *hold;
+	unsigned int longest = 0;
+
+	list_for_each_entry(hold, &ctx->resources[resource_id].holders, holders) {
+		struct process *p = hold->process;
+
+		/* Back to the current through a cycle. See __check_deadlock() */
+		if (p == current) continue;
+
+		if (p->__walk != ctx->__nr_walks) {
+			p->__walk = ctx->__nr_walks;
+			p->__depth = 0;
+
+			if (p->prio_orig < current->prio) current->__inverted = true;
+			__trace_prio(ctx, p);
+
+			if (p->waiting_on >= 0) p->__depth = __walk_blockers(ctx, p->waiting_on);
+		}
+		if (p->__depth + 1 > longest) longest = p->__depth + 1;
+	}
+	return longest;
+}
+
+/**
+ * Measure the blocking chain that the current has just been blocked by.
+ * The holders are followed through @waiting_on, which is maintained by the
+ * wait queue functions of pa2.c
+ */
+static void __account_blocking(struct sim_context *ctx, int resource_id)
+{
+	struct process *current = ctx->current;
+	unsigned int length;
+
+	current->__inverted = false;
+
+	current->__walk = ++ctx->__nr_walks;
+	length = __walk_blockers(ctx, resource_id);
+
+	if (length > current->__chain) current->__chain = length;
+	if (length > ctx->__max_chain) ctx->__max_chain = length;
+	if (current->__inverted) ctx->__nr_inversions++;
+}
+
+/**
+ * Record that the current holds the resource of @rs, or does not any longer
+ */
+static void __hold_resource(struct sim_context *ctx, struct resource_schedule *rs)
+{
+	struct resource *r = ctx->resources + rs->resource_id;
+
+	rs->hold.process = ctx->current;
+	rs->hold.resource_id = rs->resource_id;
+	rs->hold.shared = rs->shared;
+
+	list_add_tail(&rs->hold.holders, &r->holders);
+	list_add_tail(&rs->hold.holding, &ctx->current->holding);
+	if (rs->shared) {
+		r->nr_shared++;
+	} else {
+		r->nr_exclusive++;
+	}
+}
+
+static void __unhold_resource(struct sim_context *ctx, struct resource_schedule *rs)
+{
+	struct resource *r = ctx->resources + rs->resource_id;
+
+	list_del(&rs->hold.holders);
+	list_del(&rs->hold.holding);
+	if (rs->shared) {
+		r->nr_shared--;
+	} else {
+		r->nr_exclusive--;
+	}
+}
+
+/**
+ * Process resource acqutision
+ */
+static bool __run_current_acquire(struct sim_context *ctx)
+{
+	struct process *current = ctx->current;
+	struct resource_schedule *rs, *tmp;
+
+	/* The schedules are sorted by @at, so look at the head only */
+	list_for_each_entry_safe(rs, tmp, &current->__resources_to_acquire, list) {
+		if (rs->at != current->age) break;
+
+		assert(ctx->sched->acquire && "scheduler.acquire() not implemented");
+
+		/* Callback to acquire the resource in the mode */
+		current->shared = rs->shared;
+		if (ctx->sched->acquire(ctx, rs->resource_id)) {
+			list_del(&rs->list);
+			__hold_resource(ctx, rs);
+			pq_push(&current->__resources_releasing, &rs->pq,
+					(unsigned long long)rs->at + rs->duration);
+
+			__trace_event(ctx, ctx->cpu, current->pid,
+					SIM_EVENT_ACQUIRE, rs->resource_id);
+			__trace_prio(ctx, current);
+		} else {
+			current->__blocked_on = rs->resource_id;
+			__account_blocking(ctx, rs->resource_id);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Release @rs held by the current, and free it
+ */
+static void __release_resource(struct sim_context *ctx, struct resource_schedule *rs)
+{
+	struct list_head *tail = ctx->readyqueue.prev;
+
+	assert(ctx->sched->release && "scheduler.release() not implemented");
+
+	/* Callback the release(), which may wake up processes */
+	__unhold_resource(ctx, rs);
+	ctx->sched->release(ctx, rs->resource_id);
+	__account_wakeups(ctx, tail);
+
+	__trace_event(ctx, ctx->cpu, ctx->current->pid,
+			SIM_EVENT_RELEASE, rs->resource_id);
+	__trace_prio(ctx, ctx->current);
+
+	sim_pool_free(&ctx->__schedules, rs);
+}
+
+/**
+ * Process resource release. Return the number of released resources
+ */
+static int __run_current_release(struct sim_context *ctx)
+{
+	struct process *current = ctx->current;
+	struct pq_node *node;
+	int nr_released = 0;
+
+	while ((node = pq_peek(&current->__resources_releasing)) &&
+			node->key <= current->age) {
+		struct resource_schedule *rs =
+				pq_entry(node, struct resource_schedule, pq);
+
+		pq_remove(&current->__resources_releasing, node);
+		__release_resource(ctx, rs);
+		nr_released++;
+	}
+	return nr_released;
+}
+
+
+/***********************************************************************
+ * Deadlock detection
+ *
+ * DESCRIPTION
+ *   Only the processes waiting for resources point to others in the
+ *   wait-for graph, and a process acquiring a resource is not waiting.
+ *   Hence a new cycle can be formed only by the edges of the process
+ *   blocked just now, and is found by walking the graph from there back
+ *   to itself.
+ *
+ *   The cycle is reported to stderr, and handled as set in @deadlock of
+ *   struct sim_context. SIM_DEADLOCK_ABORT stops the simulation at the end
+ *   of the tick, leaving the processes as they are for sim_dump_status().
+ *   SIM_DEADLOCK_KILL kills the process of the lowest original priority in
+ *   the cycle (the one blocked just now on a tie); it releases all the
+ *   resources it holds as if it had run to the release, and exits.
+ */
+int sim_find_deadlock_policy(const char *name)
+{
+	if (strcmp(name, "report") == 0) return SIM_DEADLOCK_REPORT;
+	if (strcmp(name, "abort") == 0) return SIM_DEADLOCK_ABORT;
+	if (strcmp(name, "kill") == 0) return SIM_DEADLOCK_KILL;
+	return -1;
+}
+
+/**
+ * Kill @victim waiting in the deadlock. It might have been blocked on any
+ * CPU, including the loaded one just now
+ */
+static void __kill_process(struct sim_context *ctx, struct process *victim)
+{
+	struct process *current = ctx->current;
+	int resource_id = victim->waiting_on;
+	struct pq_node *node;
+
+	__account_unblocking(ctx, victim);
+
+	/* Give up waiting, and take back what it has lent to the holders */
+	pq_remove(&ctx->resources[resource_id].waiters, &victim->waiting);
+	list_del_init(&victim->list);
+	victim->waiting_on = -1;
+	if (ctx->sched->cancel) ctx->sched->cancel(ctx, resource_id);
+	__free_schedules(ctx, &victim->__resources_to_acquire);
+
+	/* Release the resources in its name, which wakes up the others */
+	ctx->current = victim;
+	while ((node = pq_pop(&victim->__resources_releasing))) {
+		__release_resource(ctx,
+				pq_entry(node, struct resource_schedule, pq));
+	}
+	/* The current blocked just now might have been woken up by them */
+	if (current == victim || current->status != PROCESS_WAIT) current = NULL;
+	ctx->current = current;
+
+	/* Blocked as the current of the other CPU which has not scheduled since */
+	if (victim->cpu != ctx->cpu && ctx->cpus[victim->cpu].current == victim) {
+		ctx->cpus[victim->cpu].current = NULL;
+	}
+
+	/* It has been accounted out of the CPU when blocked */
+	ctx->cpus[victim->cpu].nr_running++;
+
+	victim->status = PROCESS_EXIT;
+	__exit_process(ctx, victim);
+	ctx->__nr_killed++;
+}
+
+/**
+ * Find a cycle back to the current through the holders of @resource_id,
+ * which @p is waiting for. Return the process waiting for the current in
+ * the cycle, or NULL if there is no cycle. The processes in the cycle are
+ * linked back to the current through @__walked_from
+ */
+static struct process *__find_cycle(struct sim_context *ctx,
+		struct process *p, int resource_id)
+{
+	struct resource_hold *hold;
+
+	list_for_each_entry(hold, &ctx->resources[resource_id].holders, holders) {
+		struct process *holder = hold->process;
+		struct process *last;
+
+		if (holder == ctx->current) return p;
+		if (holder->__walk == ctx->__nr_walks) continue;
+
+		holder->__walk = ctx->__nr_walks;
+		holder->__walked_from = p;
+
+		if (holder->waiting_on < 0) continue;
+		if ((last = __find_cycle(ctx, holder, holder->waiting_on))) return last;
+	}
+	return NULL;
+}
+
+/**
+ * Print out the cycle from the current to @p, and return the process of
+ * the lowest original priority in there, the earliest one on a tie
+ */
+static struct process *__report_cycle(struct sim_context *ctx, struct process *p)
+{
+	struct process *victim;
+
+	if (p == ctx->current) {
+		fprintf(stderr, "Deadlock at tick %u: %d", ctx->ticks, p->pid);
+		return p;
+	}
+
+	victim = __report_cycle(ctx, p->__walked_from);
+	fprintf(stderr, " -> r%d -> %d", p->__walked_from->waiting_on, p->pid);
+
+	return p->prio_orig < victim->prio_orig ? p : victim;
+}
+
+/**
+ * Check whether the current blocked just now has closed a cycle of waiters.
+ * Killing a process may leave other cycles through the other holders, so
+ * look for them again until the current is not waiting any longer
+ */
+static void __check_deadlock(struct sim_context *ctx)
+{
+	struct process *last, *victim;
+
+	while (ctx->current && ctx->current->waiting_on >= 0) {
+		ctx->current->__walk = ++ctx->__nr_walks;
+		last = __find_cycle(ctx, ctx->current, ctx->current->waiting_on);
+		if (!last) return;
+
+		ctx->__nr_deadlocks++;
+
+		victim = __report_cycle(ctx, last);
+		fprintf(stderr, " -> r%d -> %d", last->waiting_on, ctx->current->pid);
+
+		switch (ctx->deadlock) {
+		case SIM_DEADLOCK_ABORT:
+			fprintf(stderr, ", aborting\n");
+			return;
+		case SIM_DEADLOCK_KILL:
+			fprintf(stderr, ", killing %d\n", victim->pid);
+			__kill_process(ctx, victim);
+			break;
+		default:
+			fprintf(stderr, "\n");
+			return;
+		}
+	}
+}
+
+
+/***********************************************************************
+ * Event-driven tick skipping
+ *
+ * DESCRIPTION
+ *   Compute how many ticks from now on can be simulated without any
+ *   event; no fork, no acquire, no release, no I/O, no exit, and no
+ *   scheduling decision (as told by scheduler.slice()). Those ticks are
+ *   then fast forwarded while generating the same output as running them
+ *   one by one.
+ */
+static unsigned int __next_fork_at(struct sim_context *ctx)
+{
+	struct pq_node *node;
+
+	__pull_stream(ctx);
+	node = pq_peek(&ctx->__forkqueue);
+
+	/* Nothing is known beyond what has been streamed in */
+	if (ctx->__stream && (!node || node->key > ctx->__stream_until)) {
+		return ctx->__stream_until;
+	}
+	return node ? node->key : UINT_MAX;
+}
+
+/**
+ * The next fork or I/O event, whichever comes first
+ */
+static unsigned int __next_event_at(struct sim_context *ctx)
+{
+	unsigned int next_fork = __next_fork_at(ctx);
+	unsigned int next_io = __next_io_at(ctx);
+
+	return next_fork < next_io ? next_fork : next_io;
+}
+
+static unsigned int __ticks_to_skip(struct sim_context *ctx)
+{
+	struct process *current = ctx->current;
+	unsigned int nr_ticks = ctx->sched->slice(ctx);
+	unsigned int next_event = __next_event_at(ctx);
+	struct pq_node *release = pq_peek(&current->__resources_releasing);
+	struct resource_schedule *rs;
+
+	/* Stop right before the next fork or I/O completion */
+	if (next_event - ctx->ticks < nr_ticks) nr_ticks = next_event - ctx->ticks;
+
+	/* and before the tick to exit */
+	if (current->lifespan - current->age < nr_ticks) {
+		nr_ticks = current->lifespan - current->age;
+	}
+
+	/* and before the next resource acquisition */
+	if (!list_empty(&current->__resources_to_acquire)) {
+		rs = list_first_entry(&current->__resources_to_acquire,
+				struct resource_schedule, list);
+		if (rs->at >= current->age && rs->at - current->age < nr_ticks) {
+			nr_ticks = rs->at - current->age;
+		}
+	}
+
+	/* and before the tick to release a resource */
+	if (release && release->key - current->age - 1 < nr_ticks) {
+		nr_ticks = release->key - current->age - 1;
+	}
+
+	/* and before the tick to issue an I/O */
+	if (!list_empty(&current->__io_to_issue)) {
+		rs = list_first_entry(&current->__io_to_issue,
+				struct resource_schedule, list);
+		if (rs->at > current->age && rs->at - current->age - 1 < nr_ticks) {
+			nr_ticks = rs->at - current->age - 1;
+		}
+	}
+
+	return nr_ticks;
+}
+
+/**
+ * Equivalent to sprintf(buffer, "%*d", width, value) for non-negative value
+ */
+static size_t __format_uint(char *buffer, unsigned int value, int width)
+{
+	char digits[16];
+	int nr_digits = 0;
+	size_t len = 0;
+
+	do {
+		digits[nr_digits++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+
+	while (width-- > nr_digits) buffer[len++] = ' ';
+	while (nr_digits) buffer[len++] = digits[--nr_digits];
+
+	return len;
+}
+
+/**
+ * Render @nr_ticks ticks of the current running from now on into the text
+ * timeline. Render them into a large buffer instead of calling fprintf()
+ * on the (usually unbuffered) trace for each tick. The output is identical
+ * to sim_render_event() of the run on each tick.
+ */
+static void __render_running_ticks(struct sim_context *ctx, unsigned int nr_ticks)
+{
+	struct process *current = ctx->current;
+	char buffer[1 << 16];
+	size_t len = 0;
+
+	for (unsigned int i = 0; i < nr_ticks; i++) {
+		if (len + 32 + current->pid * 4 > sizeof(buffer)) {
+			fwrite(buffer, 1, len, ctx->trace);
+			len = 0;
+		}
+		len += __format_uint(buffer + len, ctx->ticks + i, 3);
+		buffer[len++] = ':';
+		buffer[len++] = ' ';
+		if (current->pid * 4 + 32 <= sizeof(buffer)) {
+			memset(buffer + len, ' ', current->pid * 4);
+			len += current->pid * 4;
+		} else {
+			fwrite(buffer, 1, len, ctx->trace);
+			len = 0;
+			fprintf(ctx->trace, "%*s", current->pid * 4, "");
+		}
+		len += __format_uint(buffer + len, current->pid, 0);
+		buffer[len++] = '\n';
+	}
+	fwrite(buffer, 1, len, ctx->trace);
+}
+
+static void __skip_running_ticks(struct sim_context *ctx)
+{
+	struct process *current = ctx->current;
+	unsigned int nr_ticks = __ticks_to_skip(ctx);
+
+	if (!nr_ticks) return;
+
+	/* A single record for all the ticks in the binary event log */
+	if (ctx->__events) {
+		__trace_event(ctx, ctx->cpu, current->pid, SIM_EVENT_RUN, nr_ticks);
+	} else if (ctx->trace) {
+		__render_running_ticks(ctx, nr_ticks);
+	}
+
+	__account_devices(ctx, nr_ticks);
+	ctx->ticks += nr_ticks;
+	current->age += nr_ticks;
+	ctx->cpus[ctx->cpu].nr_busy += nr_ticks;
+}
+
+static void __skip_idle_ticks(struct sim_context *ctx)
+{
+	unsigned int next_event = __next_event_at(ctx);
+
+	/* Processes are waiting for resources forever. Let it idle as is */
+	if (next_event == UINT_MAX || !list_empty(&ctx->readyqueue)) return;
+
+	if (next_event <= ctx->ticks) return;
+
+	/**
+	 * Nothing is runnable, so nothing can happen until the next fork or
+	 * the next I/O completion
+	 */
+	__trace_event(ctx, ctx->cpu, 0, SIM_EVENT_IDLE, next_event - ctx->ticks);
+
+	ctx->cpus[ctx->cpu].nr_idle += next_event - ctx->ticks;
+	ctx->__nr_idle += next_event - ctx->ticks;
+	__account_devices(ctx, next_event - ctx->ticks);
+	ctx->ticks = next_event;
+}
+
+
+/***********************************************************************
+ * The main loop for the scheduler simulation
+ */
+enum cpu_state {
+	CPU_IDLE,		/* No process to run */
+	CPU_PROGRESSED,	/* The current made a progress */
+	CPU_RELEASED,	/* Ditto, and released resources */
+	CPU_IO,			/* Ditto, and issued an I/O */
+	CPU_BLOCKED,	/* The current was blocked */
+	CPU_SWITCHING,	/* Switching to the current */
+	CPU_SWITCHED,	/* The current made a progress right after switched in */
+};
+
+/**
+ * Spend one tick of the context switch to the current. @switching counts
+ * the ticks to switch plus the first tick to run after the switch
+ */
+static enum cpu_state __switch_tick(struct sim_context *ctx)
+{
+	struct sim_cpu *cpu = ctx->cpus + ctx->cpu;
+
+	__trace_event(ctx, ctx->cpu, ctx->current->pid, SIM_EVENT_SWITCH, 0);
+
+	cpu->switching--;
+	cpu->nr_switch_ticks++;
+	ctx->__nr_switch_ticks++;
+
+	return CPU_SWITCHING;
+}
+
+/**
+ * Simulate one tick on the CPU loaded in @ctx
+ */
+static enum cpu_state __simulate_cpu(struct sim_context *ctx)
+{
+	struct sim_cpu *cpu = ctx->cpus + ctx->cpu;
+	struct process *prev;
+	bool switched_in = false;
+	int nr_released;
+
+	/* The current cannot run nor be scheduled out until switched in */
+	if (cpu->switching > 1) return __switch_tick(ctx);
+
+	/* Switched in. Let it run one tick before scheduling again */
+	if (cpu->switching) {
+		cpu->switching = 0;
+		switched_in = true;
+		goto run;
+	}
+
+	/* Ask scheduler to pick the next process to run */
+	prev = ctx->current;
+	ctx->current = ctx->sched->schedule(ctx);
+
+	/* If the CPU ran a process in the previous tick, */
+	if (prev) {
+		/* Update the process status */
+		if (prev->status == PROCESS_RUNNING) {
+			prev->status = PROCESS_READY;
+		}
+
+		/* Decommission it if completed */
+		if (prev->age == prev->lifespan) {
+			prev->status = PROCESS_EXIT;
+			__exit_process(ctx, prev);
+		}
+	}
+
+	/* Nothing to run on this CPU. Try bringing in some from the others */
+	if (!ctx->current && ctx->balancer && ctx->balancer->idle &&
+			ctx->balancer->idle(ctx)) {
+		ctx->current = ctx->sched->schedule(ctx);
+	}
+
+	/* No process is ready to run at this moment */
+	if (!ctx->current) return CPU_IDLE;
+
+	/* Execute the current process */
+	ctx->current->status = PROCESS_RUNNING;
+
+	/* Ensure that @current is detached from any list */
+	assert(list_empty(&ctx->current->list));
+
+	if (ctx->current->__first_run == UINT_MAX) {
+		ctx->current->__first_run = ctx->ticks;
+	}
+
+	/* Switching to another process costs @switch_cost ticks */
+	if (ctx->current != prev) {
+		cpu->nr_switches++;
+		ctx->__nr_switches++;
+
+		if (ctx->switch_cost) {
+			cpu->switching = ctx->switch_cost + 1;
+			return __switch_tick(ctx);
+		}
+	}
+
+run:
+	/* Try acquiring scheduled resources */
+	if (__run_current_acquire(ctx)) {
+		/* Succesfully acquired all the resources to make a progress! */
+		__trace_event(ctx, ctx->cpu, ctx->current->pid, SIM_EVENT_RUN, 1);
+
+		/* So, it ages by one tick */
+		ctx->current->age++;
+
+		cpu->nr_busy++;
+
+		/* And performs scheduled releases */
+		nr_released = __run_current_release(ctx);
+
+		/* and the I/O */
+		if (__run_current_io(ctx)) return CPU_IO;
+
+		if (nr_released) return CPU_RELEASED;
+
+		/* The scheduler has not seen this tick yet. Do not skip ticks */
+		if (switched_in) return CPU_SWITCHED;
+
+		return CPU_PROGRESSED;
+	}
+
+	/**
+	 * The current is blocked while acquiring resource(s).
+	 * In this case, @current could not make a progress in this tick
+	 */
+	__trace_event(ctx, ctx->cpu, ctx->current->pid, SIM_EVENT_BLOCK, 0);
+	if (ctx->current->status == PROCESS_WAIT) {
+		ctx->current->__blocked_at = ctx->ticks;
+		cpu->nr_running--;
+	}
+	cpu->nr_blocked++;
+	ctx->__nr_blocked++;
+
+	/* The current might have closed a cycle of waiters, and be killed */
+	__check_deadlock(ctx);
+
+	/* Thus, it is not get aged nor unable to perform releases */
+	return CPU_BLOCKED;
+}
+
+static void __do_simulation(struct sim_context *ctx)
+{
+	enum cpu_state *states = malloc(sizeof(*states) * ctx->nr_cpus);
+
+	assert(ctx->sched->schedule && "scheduler.schedule() not implemented");
+
+	while (true) {
+		bool finished = true;
+
+		/* Fork processes on schedule */
+		__pull_stream(ctx);
+		__fork_on_schedule(ctx);
+
+		/* Complete and start I/Os */
+		__run_devices(ctx);
+
+		/* Run the CPUs one by one */
+		for (unsigned int cpu = 0; cpu < ctx->nr_cpus; cpu++) {
+			__load_cpu(ctx, cpu);
+			states[cpu] = __simulate_cpu(ctx);
+
+			if (states[cpu] != CPU_IDLE || !list_empty(&ctx->readyqueue)) {
+				finished = false;
+			}
+		}
+
+		/* Stop right after the deadlock if asked to */
+		if (ctx->__nr_deadlocks && ctx->deadlock == SIM_DEADLOCK_ABORT) break;
+
+		/* Quit simulation if no pending process exists */
+		if (finished && pq_empty(&ctx->__forkqueue) && !ctx->__stream &&
+				__next_io_at(ctx) == UINT_MAX) break;
+
+		/* Idle temporarily */
+		for (unsigned int cpu = 0; cpu < ctx->nr_cpus; cpu++) {
+			if (states[cpu] != CPU_IDLE) continue;
+
+			__trace_event(ctx, cpu, 0, SIM_EVENT_IDLE, 1);
+			ctx->cpus[cpu].nr_idle++;
+			ctx->__nr_idle++;
+		}
+
+		/* Balance the load among the CPUs */
+		if (ctx->balancer && ctx->balancer->tick) {
+			ctx->balancer->tick(ctx);
+		}
+
+		/* Increase the tick counter */
+		__account_devices(ctx, 1);
+		ctx->ticks++;
+
+		/**
+		 * Fast forward the ticks in which nothing happens. Releases may
+		 * wake up processes or restore the inherited priority of the
+		 * current, so let the scheduler see them on the next tick first
+		 */
+		if (ctx->event_driven && ctx->sched->slice && ctx->nr_cpus == 1) {
+			if (states[0] == CPU_PROGRESSED) {
+				__skip_running_ticks(ctx);
+			} else if (states[0] == CPU_IDLE) {
+				__skip_idle_ticks(ctx);
+			}
+		}
+	}
+
+	free(states);
+}
+
+
+static void __print_banner(struct sim_context *ctx);
+
+void sim_init(struct sim_context *ctx, struct scheduler *sched, bool quiet)
+{
+	INIT_LIST_HEAD(&ctx->readyqueue);
+	ctx->current = NULL;
+	ctx->ticks = 0;
+
+	ctx->resources = NULL;
+	ctx->nr_resources = 0;
+
+	for (int i = 0; i < NR_DEVICES; i++) {
+		ctx->devices[i].policy = SIM_DEVICE_FCFS;
+		INIT_LIST_HEAD(&ctx->devices[i].queue);
+		ctx->devices[i].serving = NULL;
+		ctx->devices[i].done_at = 0;
+		ctx->devices[i].nr_requests = 0;
+		ctx->devices[i].nr_busy = 0;
+	}
+
+	ctx->sched = sched;
+	ctx->sched_data = NULL;
+	ctx->options = NULL;
+
+	ctx->quantum = 1;
+	ctx->switch_cost = 0;
+
+	ctx->quiet = quiet;
+	ctx->event_driven = false;
+	ctx->deadlock = SIM_DEADLOCK_REPORT;
+	ctx->trace = stderr;
+	ctx->events = NULL;
+	ctx->chrome = NULL;
+
+	ctx->nr_cpus = 1;
+	ctx->cpu = 0;
+	ctx->cpus = NULL;
+	ctx->balancer = NULL;
+
+	pq_init(&ctx->__forkqueue);
+	ctx->__events = NULL;
+	ctx->__chrome = NULL;
+	ctx->__stream = NULL;
+	ctx->__stream_until = 0;
+	sim_pool_init(&ctx->__processes, sizeof(struct process), 256);
+	sim_pool_init(&ctx->__schedules, sizeof(struct resource_schedule), 256);
+	ctx->__nr_idle = 0;
+	ctx->__nr_blocked = 0;
+	ctx->__nr_switches = 0;
+	ctx->__nr_switch_ticks = 0;
+	ctx->__nr_inversions = 0;
+	ctx->__max_inversion = 0;
+	ctx->__max_chain = 0;
+	ctx->__nr_deadlocks = 0;
+	ctx->__nr_killed = 0;
+	ctx->__nr_walks = 0;
+	INIT_LIST_HEAD(&ctx->records);
+	INIT_LIST_HEAD(&ctx->__forked);
+
+	if (!quiet) __print_banner(ctx);
+}
+
+
+static void __print_banner(struct sim_context *ctx)
+{
 	printf("**************************************************************\n");
 	printf("*\n");
-	printf("*   Simulating %s scheduler\n", sched->name);
+	printf("*   Simulating %s scheduler\n", ctx->sched->name);
 	printf("*\n");
 	printf("**************************************************************\n");
 	printf("   N: Forked\n");
@@ -412,90 +1975,141 @@ static void __initialize(void)
 	printf("   =: Blocked\n");
 	printf("  +n: Acquire resource n\n");
 	printf("  -n: Release resource n\n");
+	printf("  !n: Issue I/O to device n\n");
+	printf("  *n: Complete I/O on device n\n");
 	printf("\n");
 }
 
 
-static void __print_usage(char * const name)
+/**
+ * Call scheduler.finalize() on the first @nr_cpus CPUs
+ */
+static void __finalize_cpus(struct sim_context *ctx, unsigned int nr_cpus)
 {
-	printf("Usage: %s {-q} -[f|s|S|r|p|i] [process script file]\n", name);
-	printf("\n");
-	printf("  -q: Run quietly\n\n");
-	printf("  -f: Use FIFO scheduler (default)\n");
-	printf("  -s: Use SJF scheduler\n");
-	printf("  -S: Use SRTF scheduler\n");
-	printf("  -r: Use Round-robin scheduler\n");
-	printf("  -p: Use Priority scheduler\n");
-	printf("  -c: Use Priority with PCP scheduler\n");
-	printf("  -i: Use Priority with PIP scheduler\n");
-	printf("\n");
-}
+	if (!ctx->sched->finalize) return;
 
+	for (unsigned int cpu = 0; cpu < nr_cpus; cpu++) {
+		__load_cpu(ctx, cpu);
+		ctx->sched->finalize(ctx);
+	}
+}
 
-int main(int argc, char * const argv[])
+int sim_run(struct sim_context *ctx)
 {
-	int opt;
-	char *scriptfile;
+	struct sim_context *prev = __sim_this;
 
-	while ((opt = getopt(argc, argv, "qfsSrpich")) != -1) {
-		switch (opt) {
-		case 'q':
-			quiet = true;
-			break;
+	__sim_this = ctx;
 
-		case 'f':
-			sched = &fifo_scheduler;
-			break;
-		case 's':
-			sched = &sjf_scheduler;
-			break;
-		case 'S':
-			sched = &srtf_scheduler;
-			break;
-		case 'r':
-			sched = &rr_scheduler;
-			break;
-		case 'p':
-			sched = &prio_scheduler;
-			break;
-		case 'i':
-			sched = &pip_scheduler;
-			break;
-		case 'c':
-			sched = &pcp_scheduler;
-			break;
-		case 'h':
-		default:
-			__print_usage(argv[0]);
-			return EXIT_FAILURE;
+	assert(ctx->nr_cpus >= 1);
+	ctx->cpus = calloc(ctx->nr_cpus, sizeof(*ctx->cpus));
+	for (unsigned int cpu = 0; cpu < ctx->nr_cpus; cpu++) {
+		INIT_LIST_HEAD(&ctx->cpus[cpu].readyqueue);
+	}
+	ctx->cpu = 0;
+
+	/* Each CPU has its own instance of the scheduler data */
+	for (unsigned int cpu = 0; cpu < ctx->nr_cpus; cpu++) {
+		__load_cpu(ctx, cpu);
+		if (ctx->sched->initialize && ctx->sched->initialize(ctx)) {
+			__finalize_cpus(ctx, cpu);
+			__sim_this = prev;
+			return -1;
+		}
+	}
+	__load_cpu(ctx, 0);
+
+	if (ctx->events) {
+		ctx->__events = sim_event_log_open(ctx->events, ctx->nr_cpus);
+		if (!ctx->__events) {
+			fprintf(stderr, "Cannot write the event log\n");
+			__finalize_cpus(ctx, ctx->nr_cpus);
+			__sim_this = prev;
+			return -1;
 		}
 	}
 
-	if (optind >= argc) {
-		__print_usage(argv[0]);
-		return EXIT_FAILURE;
+	if (ctx->chrome) {
+		ctx->__chrome = sim_chrome_open(ctx->chrome, ctx->nr_cpus);
+		if (!ctx->__chrome) {
+			fprintf(stderr, "Cannot write the Chrome trace\n");
+			if (ctx->__events) {
+				sim_event_log_close(ctx->__events);
+				ctx->__events = NULL;
+			}
+			__finalize_cpus(ctx, ctx->nr_cpus);
+			__sim_this = prev;
+			return -1;
+		}
 	}
 
-	scriptfile = argv[optind];
+	__do_simulation(ctx);
 
-	__initialize();
+	if (ctx->__events) {
+		sim_event_log_close(ctx->__events);
+		ctx->__events = NULL;
+	}
+	if (ctx->__chrome) {
+		sim_chrome_close(ctx->__chrome);
+		ctx->__chrome = NULL;
+	}
 
-	if (!__load_script(scriptfile)) {
-		return EXIT_FAILURE;
+	__finalize_cpus(ctx, ctx->nr_cpus);
+	__load_cpu(ctx, 0);
+
+	__sim_this = prev;
+	return ctx->__nr_deadlocks && ctx->deadlock == SIM_DEADLOCK_ABORT;
+}
+
+
+void sim_destroy(struct sim_context *ctx)
+{
+	struct pq_node *node;
+
+	/* Processes that are never forked when the simulation is aborted */
+	while ((node = pq_pop(&ctx->__forkqueue))) {
+		struct process *p = pq_entry(node, struct process, pq);
+
+		__free_schedules(ctx, &p->__resources_to_acquire);
+		__free_schedules(ctx, &p->__io_to_issue);
+		pq_destroy(&p->__resources_releasing);
+		sim_pool_free(&ctx->__processes, p);
+	}
+	pq_destroy(&ctx->__forkqueue);
+
+	/* Processes left unfinished, e.g., waiting in a deadlock */
+	while (!list_empty(&ctx->__forked)) {
+		struct process *p =
+				list_first_entry(&ctx->__forked, struct process, __forked);
+
+		list_del(&p->__forked);
+		pq_destroy(&p->__resources_releasing);
+		free(p->sched_data);
+		p->sched_data = NULL;
 	}
 
-	if (sched->initialize && sched->initialize()) {
-		return EXIT_FAILURE;
+	for (unsigned int i = 0; i < ctx->nr_resources; i++) {
+		pq_destroy(&ctx->resources[i].waiters);
 	}
+	free(ctx->resources);
+	ctx->resources = NULL;
+	ctx->nr_resources = 0;
+
+	if (ctx->__stream) __close_stream(ctx);
+
+	/* Including the processes left unfinished */
+	sim_pool_destroy(&ctx->__processes);
+	sim_pool_destroy(&ctx->__schedules);
 
-	__do_simulation();
-	dump_status();
+	while (!list_empty(&ctx->records)) {
+		struct sim_record *rec =
+				list_first_entry(&ctx->records, struct sim_record, list);
 
-	if (sched->finalize) {
-		sched->finalize();
+		list_del(&rec->list);
+		free(rec);
 	}
 
-	return EXIT_SUCCESS;
+	free(ctx->cpus);
+	ctx->cpus = NULL;
 }
 /*          ******        DO NOT MODIFY THIS FILE        ******       */
 /*====================================================================*/
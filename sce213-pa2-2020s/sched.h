@@ -16,19 +16,25 @@
 #ifndef __SCHED_H__
 #define __SCHED_H__
 
+struct sim_context;
+
 /***********************************************************************
  * struct scheduler
  *
  * DESCRIPTION
  *   This structure is a collection of callback functions for a scheduler..
  *   Apply your scheduling policy by assigining appropriate functions to
- *   the function pointers.
+ *   the function pointers. Every callback is given the context of the
+ *   simulation @ctx (see sim.h) that it is called for. Keep the states of
+ *   the scheduler in @ctx (e.g., @ctx->sched_data) rather than in global
+ *   variables so that simulations can run in parallel. Schedulers written
+ *   without the context can be used through legacy.h.
  */
 struct scheduler {
 	const char *name;
 
 	/***********************************************************************
-	 * int initialize(void)
+	 * int initialize(struct sim_context *ctx)
 	 *
 	 * DESCRIPTION
 	 *   Call-back function for your own initialization code. It is OK to
@@ -38,46 +44,46 @@ struct scheduler {
 	 *   Return 0 on successful initialization.
 	 *   Return other value on error, which leads the program to exit.
 	 */
-	int (*initialize)(void);
+	int (*initialize)(struct sim_context *);
 
 
 	/***********************************************************************
-	 * void finalize(void)
+	 * void finalize(struct sim_context *ctx)
 	 *
 	 * DESCRIPTION
 	 *   Callback function for finalizing your code. Like @initialize(),
 	 *   you may leave this function NULL.
 	 */
-	void (*finalize)(void);
+	void (*finalize)(struct sim_context *);
 
 
 	/***********************************************************************
-	 * void fork(struct process *process)
+	 * void fork(struct sim_context *ctx, struct process *process)
 	 *
 	 * DESCRIPTION
 	 *   Called when @process is newly forked. You may do per-process
 	 *   initialization work in this function. You may leave this function
 	 *   NULL if you don't need it.
 	 */
-	void (*forked)(struct process *);
+	void (*forked)(struct sim_context *, struct process *);
 
 
 	/***********************************************************************
-	 * void exiting(struct process *process)
+	 * void exiting(struct sim_context *ctx, struct process *process)
 	 *
 	 * DESCRIPTION
 	 *   Called when @process is about to exit. You may do per-process
 	 *   finalization work in this function. You may leave this function NULL
 	 *   if you don't need it.
 	 */
-	void (*exiting)(struct process *);
+	void (*exiting)(struct sim_context *, struct process *);
 
 
 	/***********************************************************************
-	 * struct process *schedule(void)
+	 * struct process *schedule(struct sim_context *ctx)
 	 *
 	 * DESCRIPTION
-	 *   Pick a process to run next. @current points to the current process
+	 *   Pick a process to run next. @ctx->current points to the current process
 	 *   which has been running on the processor. You may put the current
 	 *   into the ready queue and pick a process to run next if the current is
 	 *   ready status. When the current is blocked (i.e., waiting for some
@@ -88,29 +94,83 @@ struct scheduler {
 	 *   process to run next
 	 *   NULL if there is no available process to schedule
 	 */
-	struct process *(*schedule)(void);
+	struct process *(*schedule)(struct sim_context *);
 
 
 	/***********************************************************************
-	 * bool acquire(int resource_id)
+	 * bool acquire(struct sim_context *ctx, int resource_id)
 	 *
 	 * DESCRIPTION
-	 *   Callback function to acquire the resource @resource_id.
+	 *   Callback function to acquire the resource @resource_id, shared if
+	 *   @ctx->current->shared is set or exclusive otherwise. On success,
+	 *   the framework adds the current to @holders of the resource.
 	 *
 	 * RETURN
 	 *   true on successful acquision
 	 *   false if the resource is already held by others or unavailable
 	 */
-	bool (*acquire)(int);
+	bool (*acquire)(struct sim_context *, int);
+
+
+	/***********************************************************************
+	 * void release(struct sim_context *ctx, int resource_id)
+	 *
+	 * DESCRIPTION
+	 *   Callbacked to release the resource @resource_id, after the framework
+	 *   has taken the current out of @holders of the resource. Put the
+	 *   processes woken up at the tail of @ctx->readyqueue.
+	 */
+	void (*release)(struct sim_context *, int);
 
 
 	/***********************************************************************
-	 * void release(int resource_id)
+	 * void cancel(struct sim_context *ctx, int resource_id)
 	 *
 	 * DESCRIPTION
-	 *   Callbacked to release the resource @resource_id
+	 *   Callbacked when a waiter of the resource @resource_id gives up
+	 *   waiting as it is killed to break a deadlock, after the framework
+	 *   has taken it out of @waitqueue and @waiters of the resource. Take
+	 *   back what the waiter has lent to the holders of the resource (e.g.,
+	 *   the priority inherited). Leave this NULL if nothing is lent.
+	 */
+	void (*cancel)(struct sim_context *, int);
+
+
+	/***********************************************************************
+	 * unsigned int slice(struct sim_context *ctx)
+	 *
+	 * DESCRIPTION
+	 *   Called in the event-driven mode (-e) right after @ctx->current made a
+	 *   progress. Return the number of following ticks for which schedule()
+	 *   would keep picking @current, provided that no process is forked or
+	 *   woken up and @current neither acquires nor releases any resource
+	 *   in the meantime. The framework may run @current for up to that many
+	 *   ticks without calling schedule(). Return 0 to have schedule() called
+	 *   on the next tick as usual. Leaving this NULL disables tick skipping.
+	 *
+	 * RETURN
+	 *   Number of ticks that @current can run without scheduling decision
+	 */
+	unsigned int (*slice)(struct sim_context *);
+
+
+	/***********************************************************************
+	 * struct process *migrate(struct sim_context *ctx)
+	 *
+	 * DESCRIPTION
+	 *   Called by the load balancer in the multi-processor simulation (-n)
+	 *   to take a ready process out of the CPU loaded in @ctx. Detach the
+	 *   process from @ctx->readyqueue and from any private queue of the
+	 *   scheduler. Do not take @ctx->current. The framework puts the process
+	 *   into @ctx->readyqueue of the destination CPU. Leaving this NULL
+	 *   takes the tail of @ctx->readyqueue, which is fine for the schedulers
+	 *   that keep ready processes in @ctx->readyqueue only.
+	 *
+	 * RETURN
+	 *   process to migrate
+	 *   NULL if there is no process to migrate
 	 */
-	void (*release)(int);
+	struct process *(*migrate)(struct sim_context *);
 };
 
 #endif
@@ -0,0 +1,375 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdio.h>
+
+#include "pool.h"
+
+struct scheduler;
+struct sim_balancer;
+struct sim_event_log;
+struct sim_chrome;
+
+/***********************************************************************
+ * struct sim_record
+ *
+ * DESCRIPTION
+ *   Record of a process (or a job of a periodic process) that has exited.
+ *   The framework appends one to @records of struct sim_context on each
+ *   exit. All times are in ticks.
+ *
+ *   A process blocked on a resource is blocked by the holders of the
+ *   resource, the holders of the resources that they are waiting for, and
+ *   so on. The blocking is a priority inversion if any process in them has
+ *   lower original priority than the blocked process, and @chain is the
+ *   longest path through them.
+ */
+struct sim_record {
+	unsigned int pid;
+	unsigned int job;
+	unsigned int arrival;		/* When forked */
+	unsigned int first_run;		/* When dispatched for the first time */
+	unsigned int finish;		/* When exited */
+	unsigned int lifespan;		/* # of ticks run. Short if killed */
+	bool killed;			/* Killed to break a deadlock */
+	unsigned int deadline;		/* Absolute deadline. 0 if none */
+	unsigned int blocked;		/* # of ticks blocked on resources */
+	unsigned int inversion;		/* Ditto, behind lower priority holders */
+	unsigned int chain;		/* Longest blocking chain blocked by */
+	unsigned int io;		/* # of ticks in I/O, including queueing */
+	struct list_head list;
+};
+
+/***********************************************************************
+ * struct sim_device
+ *
+ * DESCRIPTION
+ *   I/O device serving one request at a time. A process issues an I/O
+ *   with the io directive of the script, and waits in @queue while the
+ *   device serves the others. @queue is served in the order of the requests
+ *   (SIM_DEVICE_FCFS), or of the priority of the requesters and then of
+ *   the requests (SIM_DEVICE_PRIO) as set by the device line of the
+ *   script. When the I/O completes, the framework puts the process at the
+ *   tail of the ready queue of its CPU, as release() does for the processes
+ *   woken up.
+ */
+#define NR_DEVICES	8
+
+enum sim_device_policy {
+	SIM_DEVICE_FCFS,
+	SIM_DEVICE_PRIO,
+};
+
+struct sim_device {
+	enum sim_device_policy policy;
+	struct list_head queue;		/* Processes waiting for the device */
+	struct process *serving;	/* Process being served. NULL if idle */
+	unsigned int done_at;		/* When @serving completes */
+
+	unsigned int nr_requests;	/* # of I/Os served or being served */
+	unsigned int nr_busy;		/* # of ticks spent serving */
+};
+
+/***********************************************************************
+ * struct sim_cpu
+ *
+ * DESCRIPTION
+ *   Per-CPU states for the multi-processor simulation (-n). The framework
+ *   simulates the CPUs one by one in each tick. While a CPU is simulated,
+ *   its current process, ready queue, and scheduler data are loaded into
+ *   @current, @readyqueue, and @sched_data of struct sim_context, so the
+ *   schedulers work on the CPU as if it were the only one in the system.
+ */
+struct sim_cpu {
+	struct process *current;	/* Saved while the CPU is not loaded */
+	struct list_head readyqueue;	/* Ditto */
+	void *sched_data;		/* Ditto */
+
+	unsigned int nr_running;	/* # of processes running or ready on the CPU */
+
+	unsigned int nr_busy;		/* # of ticks in which a process made progress */
+	unsigned int nr_blocked;	/* # of ticks in which the current was blocked */
+	unsigned int nr_idle;		/* # of ticks without any process to run */
+	unsigned int nr_migrations;	/* # of processes migrated into the CPU */
+	unsigned int nr_switches;	/* # of context switches on the CPU */
+	unsigned int nr_switch_ticks;	/* # of ticks lost by the context switches */
+
+	unsigned int switching;		/* Ticks left to switch in the current */
+};
+
+/**
+ * What to do when processes wait for each other in a cycle
+ */
+enum sim_deadlock_policy {
+	SIM_DEADLOCK_REPORT,	/* Report the cycle and carry on */
+	SIM_DEADLOCK_ABORT,	/* Ditto, and stop the simulation */
+	SIM_DEADLOCK_KILL,	/* Ditto, and kill a process in the cycle */
+};
+
+/***********************************************************************
+ * struct sim_context
+ *
+ * DESCRIPTION
+ *   All the states of one simulation. The framework passes the context to
+ *   every scheduler callback, so that many simulations can run in parallel
+ *   on different threads. Include types.h, list_head.h, pqueue.h,
+ *   process.h, and resource.h before this file.
+ */
+struct sim_context {
+	/**
+	 * List head to hold the processes ready to run
+	 */
+	struct list_head readyqueue;
+
+	/**
+	 * The process that is currently running
+	 */
+	struct process *current;
+
+	/**
+	 * Number of generated ticks since the simulation was started
+	 */
+	unsigned int ticks;
+
+	/**
+	 * Resources in the system, as many as the script uses. The table grows
+	 * while loading (and streaming) the script, so refer to a resource by
+	 * its number rather than keeping a pointer to it across ticks
+	 */
+	struct resource *resources;
+	unsigned int nr_resources;
+
+	/**
+	 * The scheduling policy to simulate, and its private data. The
+	 * scheduler may set @sched_data in its initialize() callback
+	 */
+	struct scheduler *sched;
+	void *sched_data;
+
+	/**
+	 * Options to tune the scheduler in "key=value,key=value" form (-o).
+	 * Read them with sim_option()
+	 */
+	const char *options;
+
+	/**
+	 * CPUs to simulate (1 by default), and the one loaded now. Set
+	 * @nr_cpus and @balancer before sim_run()
+	 */
+	unsigned int nr_cpus;
+	unsigned int cpu;
+	struct sim_cpu *cpus;
+
+	/**
+	 * The load balancer to move processes between CPUs. NULL for none
+	 */
+	struct sim_balancer *balancer;
+
+	/**
+	 * Time quantum of the quantum-based schedulers (-Q, 1 by default), and
+	 * the ticks lost on each context switch (-x, 0 by default)
+	 */
+	unsigned int quantum;
+	unsigned int switch_cost;
+
+	/**
+	 * I/O devices in the system
+	 */
+	struct sim_device devices[NR_DEVICES];
+
+	/**
+	 * Processes exited so far, as struct sim_record in the exiting order
+	 */
+	struct list_head records;
+
+	/**
+	 * Quiet mode. True if the program was started with -q option
+	 */
+	bool quiet;
+
+	/**
+	 * Skip the ticks in which nothing can change (-e)
+	 */
+	bool event_driven;
+
+	/**
+	 * What to do when processes wait for each other in a cycle (-D).
+	 * SIM_DEADLOCK_REPORT by default. See sched.c
+	 */
+	enum sim_deadlock_policy deadlock;
+
+	/**
+	 * Where to print out the timeline of the simulation. stderr by default,
+	 * and NULL not to render the timeline at all
+	 */
+	FILE *trace;
+
+	/**
+	 * Where to write the binary event log (-b) instead of printing out the
+	 * timeline to @trace. NULL by default. See trace.h
+	 */
+	FILE *events;
+
+	/**
+	 * Where to write the Chrome trace-event JSON (-T) along with the above.
+	 * NULL by default
+	 */
+	FILE *chrome;
+
+
+	/* DO NOT ACCESS FOLLOWING VARIABLES */
+	struct pqueue __forkqueue;	/* Processes to fork, ordered by the time */
+	struct list_head __forked;	/* Processes forked and not exited yet */
+	struct sim_event_log *__events;	/* Buffer for @events */
+	struct sim_chrome *__chrome;	/* Writer for @chrome */
+	struct sim_pool __processes;	/* struct process of all the processes */
+	struct sim_pool __schedules;	/* struct resource_schedule of them */
+	FILE *__stream;			/* Script streamed in while simulating */
+	unsigned int __stream_until;	/* No more process to start before */
+
+	unsigned int __nr_idle;		/* # of ticks without any process to run */
+	unsigned int __nr_blocked;	/* # of ticks the current was blocked */
+	unsigned int __nr_switches;	/* # of context switches */
+	unsigned int __nr_switch_ticks;	/* # of ticks lost by the context switches */
+	unsigned int __nr_inversions;	/* # of blockings behind lower priority holders */
+	unsigned int __max_inversion;	/* The longest one of them in ticks */
+	unsigned int __max_chain;	/* The longest blocking chain */
+	unsigned int __nr_deadlocks;	/* # of wait cycles formed */
+	unsigned int __nr_killed;	/* # of processes killed to break them */
+	unsigned int __nr_walks;	/* # of walks of the wait-for graph */
+};
+
+
+/***********************************************************************
+ * Simulation interface
+ *
+ * DESCRIPTION
+ *   sim_init() prepares @ctx to simulate @sched, and prints out the banner
+ *   unless @quiet. Adjust @event_driven, @trace, and so on after that if needed,
+ *   load the processes to simulate with sim_load_script(), which takes
+ *   either a process script or a binary workload (see workload.h), and run the
+ *   simulation with sim_run(). sim_destroy() releases what is left in the
+ *   context.
+ *
+ *   Instead of loading the script up front, sim_stream_script() lets
+ *   sim_run() read the script from @filename (stdin if "-") as the
+ *   simulated time advances, so that a pipe or FIFO can feed the processes
+ *   of a live trace. The simulation does not advance beyond what has been
+ *   streamed in, and runs until the writer closes the stream. Stream the
+ *   processes in the order of their start, and write "tick N" lines while
+ *   idle to tell that no process will start before tick N.
+ *
+ * RETURN VALUE
+ *   sim_load_script() and sim_stream_script() return true on success,
+ *   false on error
+ *   sim_run() returns 0 on success, 1 if aborted on a deadlock, and
+ *   other value if the scheduler failed to initialize
+ *   sim_find_deadlock_policy() returns the policy named @name (report,
+ *   abort, or kill), or -1 if there is no such policy
+ */
+void sim_init(struct sim_context *ctx, struct scheduler *sched, bool quiet);
+bool sim_load_script(struct sim_context *ctx, char * const filename);
+bool sim_stream_script(struct sim_context *ctx, char * const filename);
+int sim_run(struct sim_context *ctx);
+int sim_find_deadlock_policy(const char *name);
+void sim_destroy(struct sim_context *ctx);
+
+/**
+ * Print out the processes and resources of @ctx to stdout
+ */
+void sim_dump_status(struct sim_context *ctx);
+
+/**
+ * Return the context of the simulation running on the calling thread, or
+ * NULL if the thread is not running a simulation
+ */
+struct sim_context *sim_this(void);
+
+/**
+ * Return the scheduler selected with command-line option @opt (e.g., 'f' for
+ * the FIFO scheduler) or NULL if there is no such scheduler
+ */
+struct scheduler *sim_find_scheduler(int opt);
+
+/**
+ * Return the value of scheduler option @key in @ctx->options, or @value
+ * if the option is not given
+ */
+unsigned int sim_option(struct sim_context *ctx, const char *key, unsigned int value);
+
+
+/***********************************************************************
+ * Multi-processor support
+ *
+ * DESCRIPTION
+ *   sim_current_of(), sim_readyqueue_of(), and sim_sched_data_of() return
+ *   the current process, the ready queue, and the scheduler data of @cpu
+ *   whether it is loaded or not. Use them to reach the processes on other
+ *   CPUs (e.g., to boost a lock holder queued on another CPU).
+ *
+ *   sim_migrate() moves a ready process from @src to @dst with the help of
+ *   scheduler.migrate(), and returns true if a process is moved.
+ */
+struct process *sim_current_of(struct sim_context *ctx, unsigned int cpu);
+struct list_head *sim_readyqueue_of(struct sim_context *ctx, unsigned int cpu);
+void *sim_sched_data_of(struct sim_context *ctx, unsigned int cpu);
+bool sim_migrate(struct sim_context *ctx, unsigned int src, unsigned int dst);
+
+
+/***********************************************************************
+ * struct sim_balancer
+ *
+ * DESCRIPTION
+ *   Load balancer for the multi-processor simulation. @idle() is called
+ *   when CPU @ctx->cpu has nothing to run, and returns true if it moved
+ *   a process into the CPU. @tick() is called at the end of every tick.
+ *   Either can be NULL. See balance.c for the available balancers.
+ */
+struct sim_balancer {
+	const char *name;
+	bool (*idle)(struct sim_context *ctx);
+	void (*tick)(struct sim_context *ctx);
+};
+
+/**
+ * Return the balancer named @name or NULL if there is no such balancer
+ */
+struct sim_balancer *sim_find_balancer(const char *name);
+
+
+/***********************************************************************
+ * struct sim_report
+ *
+ * DESCRIPTION
+ *   Reporter of the scheduling metrics of a finished simulation; per-process
+ *   turnaround, waiting, and response times, and their aggregates such as
+ *   the CPU utilization, Jain's fairness index, and tail percentiles.
+ *   @print() writes them to @out in the format of @name, which is one of
+ *   table, csv, and json. See metrics.c.
+ */
+struct sim_report {
+	const char *name;
+	void (*print)(struct sim_context *ctx, FILE *out);
+};
+
+/**
+ * Return the reporter named @name or NULL if there is no such reporter
+ */
+struct sim_report *sim_find_report(const char *name);
+
+#endif
@@ -0,0 +1,235 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Run (script, scheduler) simulations in parallel
+ *
+ * DESCRIPTION
+ *   Simulate every given script with every given scheduler on a pool of
+ *   threads, and print out one line of summary per simulation in the order
+ *   of the scripts and the schedulers.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+
+#include "process.h"
+#include "resource.h"
+
+#include "sched.h"
+#include "sim.h"
+
+struct sweep_job {
+	char *scriptfile;
+	int opt;			/* Scheduler option */
+
+	bool done;
+	bool aborted;			/* On a deadlock */
+	unsigned int ticks;
+	unsigned int nr_idle;
+	unsigned int nr_blocked;
+	unsigned int nr_switches;
+	unsigned int nr_switch_ticks;
+	unsigned int nr_deadlocks;
+};
+
+static struct sweep_job *jobs;
+static unsigned int nr_jobs;
+static unsigned int next_job = 0;
+
+static bool event_driven = false;
+static int nr_cpus = 1;
+static int quantum = 1;
+static int switch_cost = 0;
+static int deadlock = SIM_DEADLOCK_REPORT;
+static char *logdir = NULL;
+
+static void __run_job(struct sweep_job *job)
+{
+	struct sim_context ctx;
+	char logfile[4096];
+	char *basename = strrchr(job->scriptfile, '/');
+
+	basename = basename ? basename + 1 : job->scriptfile;
+
+	sim_init(&ctx, sim_find_scheduler(job->opt), true);
+	ctx.event_driven = event_driven;
+	ctx.nr_cpus = nr_cpus;
+	ctx.quantum = quantum;
+	ctx.switch_cost = switch_cost;
+	ctx.deadlock = deadlock;
+	ctx.balancer = sim_find_balancer("all");
+
+	/* Do not bother rendering the timeline unless asked */
+	ctx.trace = NULL;
+	if (logdir) {
+		snprintf(logfile, sizeof(logfile), "%s/%s.%c.log", logdir, basename, job->opt);
+		ctx.trace = fopen(logfile, "w");
+		if (!ctx.trace) {
+			fprintf(stderr, "Cannot open %s\n", logfile);
+			sim_destroy(&ctx);
+			return;
+		}
+	}
+
+	if (sim_load_script(&ctx, job->scriptfile)) {
+		int ret = sim_run(&ctx);
+
+		job->done = ret == 0;
+		job->aborted = ret > 0;
+		job->ticks = ctx.ticks;
+		job->nr_idle = ctx.__nr_idle;
+		job->nr_blocked = ctx.__nr_blocked;
+		job->nr_switches = ctx.__nr_switches;
+		job->nr_switch_ticks = ctx.__nr_switch_ticks;
+		job->nr_deadlocks = ctx.__nr_deadlocks;
+	}
+
+	if (ctx.trace) fclose(ctx.trace);
+	sim_destroy(&ctx);
+}
+
+static void *__worker(void *arg)
+{
+	unsigned int i;
+
+	while ((i = __sync_fetch_and_add(&next_job, 1)) < nr_jobs) {
+		__run_job(jobs + i);
+	}
+	return NULL;
+}
+
+static void __print_usage(char * const name)
+{
+	printf("Usage: %s {-j threads} {-e} {-n ncpus} {-Q quantum} {-x cost} {-D policy} {-P schedulers} {-o dir} [process script file]...\n", name);
+	printf("\n");
+	printf("  -j: Number of threads to run simulations (default: 4)\n");
+	printf("  -e: Skip the ticks in which nothing happens (event-driven)\n");
+	printf("  -n: Simulate ncpus CPUs for each simulation (default: 1)\n");
+	printf("  -Q: Time quantum of Round-robin and MLFQ in ticks (default: 1)\n");
+	printf("  -x: Ticks lost on each context switch (default: 0)\n");
+	printf("  -D: On a deadlock, report, abort the simulation, or kill a process (default: report)\n");
+	printf("  -P: Schedulers to simulate in their options of sched (default: fsSrpci)\n");
+	printf("  -o: Save the timeline of each simulation to dir/script.option.log\n");
+	printf("\n");
+}
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	int nr_threads = 4;
+	char *policies = "fsSrpci";
+	pthread_t *threads;
+
+	while ((opt = getopt(argc, argv, "j:en:Q:x:D:P:o:h")) != -1) {
+		switch (opt) {
+		case 'j':
+			nr_threads = atoi(optarg);
+			break;
+		case 'e':
+			event_driven = true;
+			break;
+		case 'n':
+			nr_cpus = atoi(optarg);
+			break;
+		case 'Q':
+			quantum = atoi(optarg);
+			break;
+		case 'x':
+			switch_cost = atoi(optarg);
+			break;
+		case 'D':
+			deadlock = sim_find_deadlock_policy(optarg);
+			if (deadlock < 0) {
+				fprintf(stderr, "Unknown deadlock policy %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'P':
+			policies = optarg;
+			break;
+		case 'o':
+			logdir = optarg;
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc || nr_threads <= 0 || nr_cpus <= 0 ||
+			quantum <= 0 || switch_cost < 0) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (char *p = policies; *p; p++) {
+		if (!sim_find_scheduler(*p)) {
+			fprintf(stderr, "Unknown scheduler option %c\n", *p);
+			return EXIT_FAILURE;
+		}
+	}
+
+	nr_jobs = (argc - optind) * strlen(policies);
+	jobs = calloc(nr_jobs, sizeof(*jobs));
+	for (int i = optind, j = 0; i < argc; i++) {
+		for (char *p = policies; *p; p++, j++) {
+			jobs[j].scriptfile = argv[i];
+			jobs[j].opt = *p;
+		}
+	}
+
+	threads = malloc(sizeof(*threads) * nr_threads);
+	for (int i = 0; i < nr_threads; i++) {
+		pthread_create(threads + i, NULL, __worker, NULL);
+	}
+	for (int i = 0; i < nr_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	printf("script,scheduler,ticks,idle,blocked,switches,lost,deadlocks\n");
+	for (unsigned int i = 0; i < nr_jobs; i++) {
+		struct sweep_job *job = jobs + i;
+
+		if (job->aborted) {
+			printf("%s,%s,deadlocked at %u,,,,,%u\n", job->scriptfile,
+					sim_find_scheduler(job->opt)->name,
+					job->ticks, job->nr_deadlocks);
+			continue;
+		}
+		if (!job->done) {
+			printf("%s,%s,failed,,,,,\n", job->scriptfile,
+					sim_find_scheduler(job->opt)->name);
+			continue;
+		}
+		printf("%s,%s,%u,%u,%u,%u,%u,%u\n", job->scriptfile,
+				sim_find_scheduler(job->opt)->name,
+				job->ticks, job->nr_idle, job->nr_blocked,
+				job->nr_switches, job->nr_switch_ticks, job->nr_deadlocks);
+	}
+
+	free(threads);
+	free(jobs);
+
+	return EXIT_SUCCESS;
+}
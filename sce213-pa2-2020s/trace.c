@@ -0,0 +1,124 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+void sim_render_event(FILE *out, unsigned int nr_cpus, const struct sim_event *ev)
+{
+	char body[16];
+	unsigned int nr_ticks = 1;
+
+	switch (ev->type) {
+	case SIM_EVENT_RUN:
+		snprintf(body, sizeof(body), "%d", ev->pid);
+		nr_ticks = ev->arg;
+		break;
+	case SIM_EVENT_FORK:
+		snprintf(body, sizeof(body), "N");
+		break;
+	case SIM_EVENT_EXIT:
+		snprintf(body, sizeof(body), "X");
+		break;
+	case SIM_EVENT_BLOCK:
+		snprintf(body, sizeof(body), "=");
+		break;
+	case SIM_EVENT_ACQUIRE:
+		snprintf(body, sizeof(body), "+%d", ev->arg);
+		break;
+	case SIM_EVENT_RELEASE:
+		snprintf(body, sizeof(body), "-%d", ev->arg);
+		break;
+	case SIM_EVENT_MIGRATE:
+		snprintf(body, sizeof(body), ">");
+		break;
+	case SIM_EVENT_SWITCH:
+		snprintf(body, sizeof(body), "~");
+		break;
+	case SIM_EVENT_IDLE:
+		nr_ticks = ev->arg;
+		break;
+	case SIM_EVENT_IO:
+		snprintf(body, sizeof(body), "!%d", ev->arg);
+		break;
+	case SIM_EVENT_IO_DONE:
+		snprintf(body, sizeof(body), "*%d", ev->arg);
+		break;
+	case SIM_EVENT_PRIO:
+		return;
+	default:
+		fprintf(out, "??? unknown event %u\n", ev->type);
+		return;
+	}
+
+	for (unsigned int i = 0; i < nr_ticks; i++) {
+		if (nr_cpus > 1) {
+			fprintf(out, "%3d@%u: ", ev->tick + i, ev->cpu);
+		} else {
+			fprintf(out, "%3d: ", ev->tick + i);
+		}
+
+		if (ev->type == SIM_EVENT_IDLE) {
+			fputs("idle\n", out);
+		} else {
+			/* Indent four spaces per pid */
+			fprintf(out, "%*s%s\n", ev->pid * 4, "", body);
+		}
+	}
+}
+
+
+static void __flush(struct sim_event_log *log)
+{
+	fwrite(log->events, sizeof(*log->events), log->nr, log->file);
+	log->nr = 0;
+}
+
+struct sim_event_log *sim_event_log_open(FILE *file, unsigned int nr_cpus)
+{
+	struct sim_event_log *log = malloc(sizeof(*log));
+	struct sim_event_header header = {
+		.magic = SIM_EVENT_MAGIC,
+		.version = SIM_EVENT_VERSION,
+		.nr_cpus = nr_cpus,
+	};
+
+	if (!log) return NULL;
+
+	if (fwrite(&header, sizeof(header), 1, file) != 1) {
+		free(log);
+		return NULL;
+	}
+
+	log->file = file;
+	log->nr = 0;
+	return log;
+}
+
+void sim_event_log_append(struct sim_event_log *log, const struct sim_event *ev)
+{
+	if (log->nr == SIM_EVENT_LOG_SIZE) __flush(log);
+
+	log->events[log->nr++] = *ev;
+}
+
+void sim_event_log_close(struct sim_event_log *log)
+{
+	__flush(log);
+	fflush(log->file);
+	free(log);
+}
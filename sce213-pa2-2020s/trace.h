@@ -0,0 +1,117 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/***********************************************************************
+ * Binary event log
+ *
+ * DESCRIPTION
+ *   Instead of rendering the text timeline, the simulator can log the
+ *   events as fixed-size records (-b). The log begins with struct
+ *   sim_event_header followed by struct sim_event records in the order of
+ *   the events, all in the byte order of the machine. sim_render_event()
+ *   renders a record into the text timeline, which is what tracecat does
+ *   for the whole log.
+ */
+#define SIM_EVENT_MAGIC		0x54434853	/* "SHCT" in little endian */
+#define SIM_EVENT_VERSION	2	/* 2: SIM_EVENT_PRIO, SIM_EVENT_IO and SIM_EVENT_IO_DONE */
+
+enum sim_event_type {
+	SIM_EVENT_RUN,		/* @pid ran for @arg ticks from @tick */
+	SIM_EVENT_FORK,
+	SIM_EVENT_EXIT,
+	SIM_EVENT_BLOCK,
+	SIM_EVENT_ACQUIRE,	/* @pid acquired resource @arg */
+	SIM_EVENT_RELEASE,	/* @pid released resource @arg */
+	SIM_EVENT_MIGRATE,	/* @pid was migrated into @cpu */
+	SIM_EVENT_SWITCH,	/* @cpu spent @tick to switch to @pid */
+	SIM_EVENT_IDLE,		/* @cpu idled for @arg ticks from @tick */
+	SIM_EVENT_PRIO,		/* The priority of @pid became @arg */
+	SIM_EVENT_IO,		/* @pid issued an I/O to device @arg */
+	SIM_EVENT_IO_DONE,	/* The I/O of @pid on device @arg completed */
+	NR_SIM_EVENTS,
+};
+
+struct sim_event_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nr_cpus;
+	uint32_t reserved;
+};
+
+struct sim_event {
+	uint32_t tick;
+	int32_t pid;
+	int32_t arg;
+	uint16_t cpu;
+	uint8_t type;
+	uint8_t reserved;
+};
+
+/**
+ * Render @ev into @out as the lines of the text timeline of a simulation
+ * on @nr_cpus CPUs. Events not shown in the timeline (e.g., SIM_EVENT_PRIO)
+ * render into nothing
+ */
+void sim_render_event(FILE *out, unsigned int nr_cpus, const struct sim_event *ev);
+
+
+/***********************************************************************
+ * struct sim_event_log
+ *
+ * DESCRIPTION
+ *   Writer of the binary event log. Events are collected in @events and
+ *   written to @file when it gets full and when the log is closed.
+ *   sim_event_log_open() writes the header and returns NULL on error.
+ */
+#define SIM_EVENT_LOG_SIZE	4096
+
+struct sim_event_log {
+	FILE *file;
+	unsigned int nr;
+	struct sim_event events[SIM_EVENT_LOG_SIZE];
+};
+
+struct sim_event_log *sim_event_log_open(FILE *file, unsigned int nr_cpus);
+void sim_event_log_append(struct sim_event_log *log, const struct sim_event *ev);
+void sim_event_log_close(struct sim_event_log *log);
+
+
+/***********************************************************************
+ * Chrome trace export
+ *
+ * DESCRIPTION
+ *   Convert events into the Chrome trace-event JSON, which chrome://tracing
+ *   and Perfetto UI open. Each CPU becomes a thread track where the runs
+ *   of processes and context switches are slices, and forks, exits, blocks,
+ *   acquires, releases, migrations, and I/Os are instant events on it. The
+ *   priority of each process is a counter track, so the boosts by PIP and
+ *   PCP show up there. A tick is shown as one millisecond.
+ *
+ *   sim_chrome_open() returns NULL on error. Events should be appended in
+ *   the order of ticks, and the trace is completed by sim_chrome_close().
+ */
+struct sim_chrome;
+
+struct sim_chrome *sim_chrome_open(FILE *file, unsigned int nr_cpus);
+void sim_chrome_append(struct sim_chrome *chrome, const struct sim_event *ev);
+void sim_chrome_close(struct sim_chrome *chrome);
+
+#endif
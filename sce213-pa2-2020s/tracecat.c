@@ -0,0 +1,109 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Render a binary event log into the text timeline
+ *
+ * DESCRIPTION
+ *   Print out the events logged with sched -b to stdout, in the same text
+ *   format as sched prints the timeline to stderr. With -T, convert them
+ *   into the Chrome trace-event JSON instead.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "trace.h"
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	FILE *file;
+	FILE *chromefile = NULL;
+	struct sim_chrome *chrome = NULL;
+	struct sim_event_header header;
+	struct sim_event events[SIM_EVENT_LOG_SIZE];
+	size_t nr;
+	char buffer[1 << 16];
+
+	while ((opt = getopt(argc, argv, "T:h")) != -1) {
+		switch (opt) {
+		case 'T':
+			chromefile = fopen(optarg, "w");
+			if (!chromefile) {
+				fprintf(stderr, "Cannot open %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'h':
+		default:
+			printf("Usage: %s {-T chrome json} [event log file]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 1 != argc) {
+		printf("Usage: %s {-T chrome json} [event log file]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	file = fopen(argv[optind], "rb");
+	if (!file) {
+		fprintf(stderr, "Cannot open %s\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+			header.magic != SIM_EVENT_MAGIC) {
+		fprintf(stderr, "%s is not an event log\n", argv[optind]);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+	if (header.version != SIM_EVENT_VERSION) {
+		fprintf(stderr, "Unsupported event log version %u\n", header.version);
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+
+	if (chromefile) {
+		chrome = sim_chrome_open(chromefile, header.nr_cpus);
+		if (!chrome) {
+			fprintf(stderr, "Out of memory\n");
+			fclose(file);
+			return EXIT_FAILURE;
+		}
+	}
+
+	setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+
+	while ((nr = fread(events, sizeof(*events), SIM_EVENT_LOG_SIZE, file))) {
+		for (size_t i = 0; i < nr; i++) {
+			if (chrome) {
+				sim_chrome_append(chrome, events + i);
+			} else {
+				sim_render_event(stdout, header.nr_cpus, events + i);
+			}
+		}
+	}
+
+	if (chrome) {
+		sim_chrome_close(chrome);
+		fclose(chromefile);
+	}
+	fclose(file);
+	fflush(stdout);
+	return EXIT_SUCCESS;
+}
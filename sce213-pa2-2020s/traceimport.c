@@ -0,0 +1,519 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Import Linux scheduler traces as process scripts
+ *
+ * DESCRIPTION
+ *   Read the text dump of the sched_switch, sched_wakeup(_new), and
+ *   sched_process_exit events, either from ftrace (trace or trace_pipe)
+ *   or from perf sched script, and write the process script replaying
+ *   the CPU demand of the traced tasks.
+ *
+ *   A burst of a task spans from its wakeup to the switch-out into a
+ *   sleep (i.e., prev_state other than R), and its lifespan is the CPU
+ *   time the task consumed in between. Each burst becomes a process
+ *   starting at the wakeup, so the arrival and burst patterns are kept
+ *   while the sleeps in between are not. With -T, each task becomes one
+ *   process running for all its CPU time instead. Bursts shorter than half
+ *   a tick are dropped.
+ *
+ *   Tasks are numbered from 1 in the order they appear in the trace, and
+ *   all the bursts of a task have its number as their PID like the jobs of
+ *   a periodic process. Kernel priorities are mapped so that nice -20 to
+ *   19 become 39 to 0, and real-time priorities 40 and above.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+
+#define MAX_PRIO	64
+#define COMM_LEN	16
+
+struct task {
+	int kpid;			/* PID in the trace */
+	unsigned int id;		/* PID in the script */
+	char comm[COMM_LEN];
+	int prio;			/* Kernel priority seen last */
+
+	bool seen;			/* Switched or woken up so far */
+	bool in_burst;			/* Woken up and not slept yet */
+	bool running;
+	uint64_t burst_at;		/* When the burst started */
+	uint64_t running_since;
+	uint64_t runtime;		/* CPU time in the burst */
+
+	uint64_t first_at;		/* For -T */
+	uint64_t total_runtime;
+};
+
+struct burst {
+	uint64_t at;
+	uint64_t runtime;
+	unsigned int id;
+	int prio;
+};
+
+static struct task **tasks;		/* Hash table keyed by @kpid */
+static size_t nr_tasks, tasks_size;
+
+static struct task **ordered;		/* Tasks in the order they appear */
+
+static struct burst *bursts;
+static size_t nr_bursts, bursts_size;
+
+static bool per_task = false;
+static uint64_t first_at = UINT64_MAX;
+static uint64_t last_at = 0;
+static unsigned int max_cpu = 0;
+
+static void *__grow(void *array, size_t *size, size_t unit)
+{
+	*size = *size ? *size * 2 : 1024;
+	array = realloc(array, unit * *size);
+	if (!array) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	return array;
+}
+
+static struct task *__find_task(int kpid, const char *comm, size_t comm_len)
+{
+	size_t i;
+	struct task *t;
+
+	if (nr_tasks * 2 >= tasks_size) {
+		struct task **old = tasks;
+		size_t old_size = tasks_size;
+
+		tasks_size = tasks_size ? tasks_size * 2 : 1024;
+		tasks = calloc(tasks_size, sizeof(*tasks));
+		ordered = realloc(ordered, sizeof(*ordered) * tasks_size);
+		if (!tasks || !ordered) {
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		for (i = 0; i < old_size; i++) {
+			size_t j;
+
+			if (!old[i]) continue;
+			for (j = old[i]->kpid & (tasks_size - 1); tasks[j];
+					j = (j + 1) & (tasks_size - 1));
+			tasks[j] = old[i];
+		}
+		free(old);
+	}
+
+	for (i = kpid & (tasks_size - 1); tasks[i]; i = (i + 1) & (tasks_size - 1)) {
+		if (tasks[i]->kpid == kpid) return tasks[i];
+	}
+
+	t = calloc(1, sizeof(*t));
+	if (!t) {
+		fprintf(stderr, "Out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	t->kpid = kpid;
+	t->id = nr_tasks + 1;
+	t->prio = 120;
+	t->first_at = UINT64_MAX;
+	if (comm_len >= COMM_LEN) comm_len = COMM_LEN - 1;
+	memcpy(t->comm, comm, comm_len);
+
+	tasks[i] = t;
+	ordered[nr_tasks++] = t;
+	return t;
+}
+
+static void __end_burst(struct task *t)
+{
+	if (!t->in_burst) return;
+
+	if (t->running) {
+		t->runtime += last_at - t->running_since;
+		t->running = false;
+	}
+
+	if (per_task) {
+		if (t->burst_at < t->first_at) t->first_at = t->burst_at;
+		t->total_runtime += t->runtime;
+	} else {
+		if (nr_bursts == bursts_size) {
+			bursts = __grow(bursts, &bursts_size, sizeof(*bursts));
+		}
+		bursts[nr_bursts++] = (struct burst) {
+			.at = t->burst_at,
+			.runtime = t->runtime,
+			.id = t->id,
+			.prio = t->prio,
+		};
+	}
+	t->in_burst = false;
+	t->runtime = 0;
+}
+
+static void __begin_burst(struct task *t, uint64_t at)
+{
+	if (t->in_burst) return;
+
+	t->in_burst = true;
+	t->burst_at = at;
+	t->runtime = 0;
+}
+
+/**
+ * Parse "SECONDS.FRACTION" into microseconds
+ */
+static bool __parse_timestamp(const char *str, uint64_t *us)
+{
+	char *end;
+	uint64_t sec = strtoull(str, &end, 10);
+	uint64_t frac = 0;
+	int nr_digits = 0;
+
+	if (end == str || *end != '.') return false;
+
+	for (str = end + 1; *str >= '0' && *str <= '9'; str++, nr_digits++) {
+		if (nr_digits < 6) frac = frac * 10 + (*str - '0');
+	}
+	for (; nr_digits < 6; nr_digits++) frac *= 10;
+
+	*us = sec * 1000000 + frac;
+	return true;
+}
+
+/**
+ * Parse the task of the perf sched script format, "COMM:PID [PRIO]".
+ * COMM may have colons and spaces. Return the end of the task or NULL
+ */
+static const char *__parse_perf_task(const char *str, const char **comm,
+		size_t *comm_len, int *pid, int *prio)
+{
+	const char *bracket = strstr(str, " [");
+	const char *colon;
+
+	while (*str == ' ') str++;
+	if (!bracket) return NULL;
+
+	for (colon = bracket - 1; colon > str && *colon != ':'; colon--);
+	if (*colon != ':') return NULL;
+
+	*comm = str;
+	*comm_len = colon - str;
+	*pid = atoi(colon + 1);
+	*prio = atoi(bracket + 2);
+
+	return strchr(bracket, ']') ? strchr(bracket, ']') + 1 : NULL;
+}
+
+static const char *__field(const char *str, const char *key)
+{
+	const char *field = strstr(str, key);
+
+	return field ? field + strlen(key) : NULL;
+}
+
+static bool __parse_switch(const char *payload, uint64_t at)
+{
+	const char *prev_comm, *next_comm;
+	size_t prev_comm_len, next_comm_len;
+	int prev_pid, next_pid, prev_prio, next_prio;
+	char prev_state;
+	const char *arrow = strstr(payload, "==>");
+
+	if (!arrow) return false;
+
+	if (__field(payload, "prev_pid=")) {
+		const char *state = __field(payload, "prev_state=");
+
+		prev_comm = __field(payload, "prev_comm=");
+		next_comm = __field(arrow, "next_comm=");
+		if (!prev_comm || !next_comm || !state ||
+				!__field(arrow, "next_pid=") || !__field(arrow, "next_prio=")) {
+			return false;
+		}
+		prev_comm_len = strstr(prev_comm, " prev_pid=") - prev_comm;
+		next_comm_len = strstr(next_comm, " next_pid=") - next_comm;
+		prev_pid = atoi(__field(payload, "prev_pid="));
+		prev_prio = atoi(__field(payload, "prev_prio="));
+		prev_state = *state;
+		next_pid = atoi(__field(arrow, "next_pid="));
+		next_prio = atoi(__field(arrow, "next_prio="));
+	} else {
+		const char *state = __parse_perf_task(payload,
+				&prev_comm, &prev_comm_len, &prev_pid, &prev_prio);
+
+		if (!state || state > arrow) return false;
+		while (*state == ' ') state++;
+		prev_state = *state;
+
+		if (!__parse_perf_task(arrow + 3,
+				&next_comm, &next_comm_len, &next_pid, &next_prio)) {
+			return false;
+		}
+	}
+
+	if (prev_pid) {
+		struct task *t = __find_task(prev_pid, prev_comm, prev_comm_len);
+
+		/* The task was running when the trace started */
+		if (!t->seen) {
+			__begin_burst(t, first_at);
+			t->running = true;
+			t->running_since = first_at;
+		}
+		t->seen = true;
+
+		if (t->running) {
+			t->runtime += at - t->running_since;
+			t->running = false;
+		}
+		t->prio = prev_prio;
+
+		/* Preempted tasks remain in the burst */
+		if (prev_state != 'R') __end_burst(t);
+	}
+
+	if (next_pid) {
+		struct task *t = __find_task(next_pid, next_comm, next_comm_len);
+
+		__begin_burst(t, at);
+		t->seen = true;
+		t->running = true;
+		t->running_since = at;
+		t->prio = next_prio;
+	}
+	return true;
+}
+
+/**
+ * sched_wakeup(_new) and sched_process_exit share the task format
+ */
+static bool __parse_wakeup(const char *payload, uint64_t at, bool exiting)
+{
+	const char *comm;
+	size_t comm_len;
+	int pid, prio;
+	struct task *t;
+
+	if (__field(payload, "comm=")) {
+		comm = __field(payload, "comm=");
+		if (!__field(comm, " pid=") || !__field(comm, " prio=")) return false;
+
+		comm_len = strstr(comm, " pid=") - comm;
+		pid = atoi(__field(comm, " pid="));
+		prio = atoi(__field(comm, " prio="));
+	} else if (!__parse_perf_task(payload, &comm, &comm_len, &pid, &prio)) {
+		return false;
+	}
+
+	if (!pid) return true;
+
+	t = __find_task(pid, comm, comm_len);
+	t->seen = true;
+	if (exiting) {
+		__end_burst(t);
+	} else {
+		__begin_burst(t, at);
+		t->prio = prio;
+	}
+	return true;
+}
+
+/**
+ * Both ftrace and perf sched script put "[CPU] ... TIMESTAMP: EVENT:"
+ * before the payload of the event
+ */
+static bool __parse_line(const char *line)
+{
+	static const char *events[] = {
+		"sched_switch:", "sched_wakeup:", "sched_wakeup_new:",
+		"sched_process_exit:", NULL,
+	};
+	const char *event = NULL, *payload, *ts, *cpu;
+	uint64_t at;
+	int i;
+
+	for (i = 0; events[i]; i++) {
+		if ((event = strstr(line, events[i]))) break;
+	}
+	if (!event) return true;	/* Not interested in */
+	payload = event + strlen(events[i]);
+
+	/* Back to the start of the event (e.g., "sched:sched_switch:") */
+	while (event > line && event[-1] != ' ') event--;
+	for (ts = event; ts > line && ts[-1] == ' '; ts--);
+	for (; ts > line && ts[-1] != ' '; ts--);
+	if (!__parse_timestamp(ts, &at)) return false;
+
+	if ((cpu = strchr(line, '[')) && cpu < ts) {
+		unsigned int nr = atoi(cpu + 1);
+		if (nr > max_cpu) max_cpu = nr;
+	}
+
+	if (first_at == UINT64_MAX) first_at = at;
+	if (at < last_at) at = last_at;	/* Per-CPU buffers may interleave */
+	last_at = at;
+
+	switch (i) {
+	case 0:
+		return __parse_switch(payload, at);
+	case 1:
+	case 2:
+		return __parse_wakeup(payload, at, false);
+	default:
+		return __parse_wakeup(payload, at, true);
+	}
+}
+
+static unsigned int __map_prio(int prio)
+{
+	if (prio >= 100) return prio > 139 ? 0 : 139 - prio;
+	if (prio < 0) return MAX_PRIO - 1;
+	return 40 + (99 - prio) * (MAX_PRIO - 41) / 99;
+}
+
+static int __compare_bursts(const void *a, const void *b)
+{
+	const struct burst *x = a, *y = b;
+
+	if (x->at != y->at) return x->at < y->at ? -1 : 1;
+	return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static void __write_process(FILE *out, unsigned int id, uint64_t at,
+		uint64_t runtime, int prio, uint64_t tick_us)
+{
+	uint64_t lifespan = (runtime + tick_us / 2) / tick_us;
+
+	if (!lifespan) return;
+
+	fprintf(out, "process %u\n", id);
+	fprintf(out, "\tstart %llu\n", (unsigned long long)((at - first_at) / tick_us));
+	fprintf(out, "\tlifespan %llu\n", (unsigned long long)lifespan);
+	fprintf(out, "\tprio %u\n", __map_prio(prio));
+	fprintf(out, "end\n\n");
+}
+
+static void __print_usage(char * const name)
+{
+	printf("Usage: %s {-T} {-u usecs} {-o file} {-v} [trace file]\n", name);
+	printf("\n");
+	printf("  Convert ftrace or perf sched script output into the process script\n");
+	printf("  -T: One process per task instead of one per burst\n");
+	printf("  -u: Microseconds per tick (default: 1000)\n");
+	printf("  -o: Write the script to file instead of stdout\n");
+	printf("  -v: Print out the tasks and their PIDs in the script to stderr\n");
+	printf("\n");
+}
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	uint64_t tick_us = 1000;
+	FILE *in, *out = stdout;
+	bool verbose = false;
+	char line[4096];
+	unsigned long lineno = 0, nr_errors = 0;
+
+	while ((opt = getopt(argc, argv, "Tu:o:vh")) != -1) {
+		switch (opt) {
+		case 'T':
+			per_task = true;
+			break;
+		case 'u':
+			tick_us = strtoull(optarg, NULL, 0);
+			break;
+		case 'o':
+			out = fopen(optarg, "w");
+			if (!out) {
+				fprintf(stderr, "Cannot open %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 1 != argc || !tick_us) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	in = strcmp(argv[optind], "-") == 0 ? stdin : fopen(argv[optind], "r");
+	if (!in) {
+		fprintf(stderr, "Cannot open %s\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	while (fgets(line, sizeof(line), in)) {
+		lineno++;
+		if (!__parse_line(line)) {
+			if (!nr_errors++) fprintf(stderr, "Cannot parse line %lu\n", lineno);
+		}
+	}
+	if (in != stdin) fclose(in);
+
+	for (size_t i = 0; i < nr_tasks; i++) {
+		__end_burst(ordered[i]);
+	}
+
+	if (per_task) {
+		for (size_t i = 0; i < nr_tasks; i++) {
+			struct task *t = ordered[i];
+
+			if (nr_bursts == bursts_size) {
+				bursts = __grow(bursts, &bursts_size, sizeof(*bursts));
+			}
+			bursts[nr_bursts++] = (struct burst) {
+				.at = t->first_at,
+				.runtime = t->total_runtime,
+				.id = t->id,
+				.prio = t->prio,
+			};
+		}
+	}
+
+	qsort(bursts, nr_bursts, sizeof(*bursts), __compare_bursts);
+	for (size_t i = 0; i < nr_bursts; i++) {
+		__write_process(out, bursts[i].id, bursts[i].at, bursts[i].runtime,
+				bursts[i].prio, tick_us);
+	}
+	if (out != stdout) fclose(out);
+
+	if (nr_errors) fprintf(stderr, "Skipped %lu unparsable lines\n", nr_errors);
+	if (verbose) {
+		for (size_t i = 0; i < nr_tasks; i++) {
+			fprintf(stderr, "%u: %s-%d\n",
+					ordered[i]->id, ordered[i]->comm, ordered[i]->kpid);
+		}
+	}
+	fprintf(stderr, "Imported %zu tasks traced on %u CPUs; replay with -n %u\n",
+			nr_tasks, max_cpu + 1, max_cpu + 1);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,381 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Convert process scripts to binary workloads and back
+ *
+ * DESCRIPTION
+ *   Convert the process script into the binary workload (see workload.h),
+ *   or the binary workload into the script with -t. The processes are
+ *   written out as they are parsed, so only the acquire and resource tables
+ *   are kept in memory. The header is written last, hence the binary workload should
+ *   go to a file rather than a pipe.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+#include "parser.h"
+
+#include "process.h"
+#include "resource.h"
+
+#include "sched.h"
+#include "sim.h"
+#include "workload.h"
+
+struct acquire_table {
+	struct sim_workload_acquire *acquires;
+	size_t nr;
+	size_t size;
+};
+
+static void __append_acquire(struct acquire_table *table,
+		uint32_t resource, uint32_t at, uint32_t duration)
+{
+	if (table->nr == table->size) {
+		table->size = table->size ? table->size * 2 : 1024;
+		table->acquires = realloc(table->acquires,
+				sizeof(*table->acquires) * table->size);
+		if (!table->acquires) {
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	table->acquires[table->nr++] = (struct sim_workload_acquire) {
+		.resource = resource,
+		.at = at,
+		.duration = duration,
+	};
+}
+
+struct resource_table {
+	struct sim_workload_resource *resources;
+	size_t nr;
+	size_t size;
+};
+
+static void __append_resource(struct resource_table *table,
+		uint32_t resource, uint32_t units)
+{
+	for (size_t i = 0; i < table->nr; i++) {
+		if (table->resources[i].resource == resource) {
+			table->resources[i].units = units;
+			return;
+		}
+	}
+
+	if (table->nr == table->size) {
+		table->size = table->size ? table->size * 2 : 64;
+		table->resources = realloc(table->resources,
+				sizeof(*table->resources) * table->size);
+		if (!table->resources) {
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	table->resources[table->nr++] = (struct sim_workload_resource) {
+		.resource = resource,
+		.units = units,
+	};
+}
+
+static bool __script_to_binary(FILE *in, FILE *out)
+{
+	char line[256];
+	unsigned long lineno = 0;
+	struct sim_workload_header header = {
+		.magic = SIM_WORKLOAD_MAGIC,
+		.version = SIM_WORKLOAD_VERSION,
+	};
+	struct sim_workload_process wp;
+	struct acquire_table table = { NULL, 0, 0 };
+	struct resource_table resources = { NULL, 0, 0 };
+	bool in_process = false;
+
+	/* Reserve the header to fill in at last */
+	if (fwrite(&header, sizeof(header), 1, out) != 1) goto out_write;
+
+	while (fgets(line, sizeof(line), in)) {
+		char *tokens[32] = { NULL };
+		int nr_tokens;
+
+		lineno++;
+		parse_command(line, &nr_tokens, tokens);
+
+		if (nr_tokens == 0) continue;
+
+		if (strcmp(tokens[0], "process") == 0 && nr_tokens == 2) {
+			memset(&wp, 0x00, sizeof(wp));
+			wp.pid = atoi(tokens[1]);
+			wp.nr_jobs = 1;
+			wp.first_acquire = table.nr;
+			in_process = true;
+			continue;
+		}
+		if (strcmp(tokens[0], "device") == 0 && nr_tokens == 3 && !in_process) {
+			int device = atoi(tokens[1]);
+
+			if (device < 0 || device >= NR_DEVICES) goto out_parse;
+
+			if (strcmp(tokens[2], "prio") == 0) {
+				header.prio_devices |= 1U << device;
+			} else if (strcmp(tokens[2], "fcfs") == 0) {
+				header.prio_devices &= ~(1U << device);
+			} else {
+				goto out_parse;
+			}
+			continue;
+		}
+		if (strcmp(tokens[0], "resource") == 0 && nr_tokens == 3 && !in_process) {
+			int resource = atoi(tokens[1]);
+			int units = atoi(tokens[2]);
+
+			if (resource < 0 || resource >= MAX_RESOURCES || units <= 0) goto out_parse;
+
+			__append_resource(&resources, resource, units);
+			continue;
+		}
+		if (!in_process) goto out_parse;
+
+		if (strcmp(tokens[0], "end") == 0 && nr_tokens == 1) {
+			if (wp.nr_jobs != 1 && !wp.period) goto out_parse;
+
+			wp.nr_acquires = table.nr - wp.first_acquire;
+			if (fwrite(&wp, sizeof(wp), 1, out) != 1) goto out_write;
+			header.nr_processes++;
+			in_process = false;
+		} else if (strcmp(tokens[0], "lifespan") == 0 && nr_tokens == 2) {
+			wp.lifespan = atoi(tokens[1]);
+		} else if (strcmp(tokens[0], "prio") == 0 && nr_tokens == 2) {
+			int prio = atoi(tokens[1]);
+
+			if (prio < 0 || prio > MAX_PRIO) goto out_parse;
+
+			wp.prio = prio;
+		} else if (strcmp(tokens[0], "start") == 0 && nr_tokens == 2) {
+			wp.start = atoi(tokens[1]);
+		} else if (strcmp(tokens[0], "deadline") == 0 && nr_tokens == 2) {
+			wp.deadline = atoi(tokens[1]);
+		} else if (strcmp(tokens[0], "period") == 0 && nr_tokens == 2) {
+			wp.period = atoi(tokens[1]);
+		} else if (strcmp(tokens[0], "jobs") == 0 && nr_tokens == 2) {
+			wp.nr_jobs = atoi(tokens[1]);
+		} else if ((strcmp(tokens[0], "acquire") == 0 ||
+					strcmp(tokens[0], "acquire-shared") == 0) && nr_tokens == 4) {
+			int resource = atoi(tokens[1]);
+			bool shared = strcmp(tokens[0], "acquire-shared") == 0;
+
+			if (resource < 0 || resource >= MAX_RESOURCES) goto out_parse;
+
+			__append_acquire(&table, resource | (shared ? SIM_WORKLOAD_SHARED : 0),
+					atoi(tokens[2]), atoi(tokens[3]));
+		} else if (strcmp(tokens[0], "io") == 0 &&
+				(nr_tokens == 3 || nr_tokens == 4)) {
+			int device = nr_tokens == 4 ? atoi(tokens[3]) : 0;
+
+			if (device < 0 || device >= NR_DEVICES) goto out_parse;
+
+			__append_acquire(&table, SIM_WORKLOAD_IO | device,
+					atoi(tokens[1]), atoi(tokens[2]));
+		} else {
+			goto out_parse;
+		}
+	}
+	if (in_process) goto out_parse;
+
+	header.nr_acquires = table.nr;
+	if (table.nr &&
+			fwrite(table.acquires, sizeof(*table.acquires), table.nr, out) != table.nr) {
+		goto out_write;
+	}
+	header.nr_resources = resources.nr;
+	if (resources.nr &&
+			fwrite(resources.resources, sizeof(*resources.resources),
+				resources.nr, out) != resources.nr) {
+		goto out_write;
+	}
+	if (fseek(out, 0, SEEK_SET) ||
+			fwrite(&header, sizeof(header), 1, out) != 1) {
+		goto out_write;
+	}
+	free(table.acquires);
+	free(resources.resources);
+	return true;
+
+out_parse:
+	fprintf(stderr, "Invalid script at line %lu\n", lineno);
+	free(table.acquires);
+	free(resources.resources);
+	return false;
+
+out_write:
+	fprintf(stderr, "Cannot write the binary workload\n");
+	free(table.acquires);
+	free(resources.resources);
+	return false;
+}
+
+static bool __binary_to_script(FILE *in, FILE *out)
+{
+	struct stat st;
+	const struct sim_workload_header *header;
+	const struct sim_workload_process *wps;
+	const struct sim_workload_acquire *was;
+	const struct sim_workload_resource *wrs;
+	void *map;
+	bool converted = false;
+
+	if (fstat(fileno(in), &st) || st.st_size < sizeof(*header) ||
+			(map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+					fileno(in), 0)) == MAP_FAILED) {
+		fprintf(stderr, "Cannot map the binary workload\n");
+		return false;
+	}
+	header = map;
+
+	if (header->magic != SIM_WORKLOAD_MAGIC ||
+			header->version != SIM_WORKLOAD_VERSION ||
+			st.st_size < sizeof(*header) +
+				(size_t)header->nr_processes * sizeof(*wps) +
+				(size_t)header->nr_acquires * sizeof(*was) +
+				(size_t)header->nr_resources * sizeof(*wrs)) {
+		fprintf(stderr, "Invalid binary workload\n");
+		goto out;
+	}
+	wps = (const void *)(header + 1);
+	was = (const void *)(wps + header->nr_processes);
+	wrs = (const void *)(was + header->nr_acquires);
+
+	for (int i = 0; i < NR_DEVICES; i++) {
+		if (header->prio_devices & (1U << i)) fprintf(out, "device %d prio\n", i);
+	}
+	for (uint32_t i = 0; i < header->nr_resources; i++) {
+		fprintf(out, "resource %u %u\n", wrs[i].resource, wrs[i].units);
+	}
+	if (header->prio_devices || header->nr_resources) fprintf(out, "\n");
+
+	for (uint32_t i = 0; i < header->nr_processes; i++) {
+		const struct sim_workload_process *wp = wps + i;
+
+		if (wp->first_acquire > header->nr_acquires ||
+				wp->nr_acquires > header->nr_acquires - wp->first_acquire) {
+			fprintf(stderr, "Corrupted process %u\n", wp->pid);
+			goto out;
+		}
+
+		fprintf(out, "process %u\n", wp->pid);
+		fprintf(out, "\tstart %u\n", wp->start);
+		fprintf(out, "\tlifespan %u\n", wp->lifespan);
+		fprintf(out, "\tprio %u\n", wp->prio);
+		if (wp->deadline) fprintf(out, "\tdeadline %u\n", wp->deadline);
+		if (wp->period) fprintf(out, "\tperiod %u\n", wp->period);
+		if (wp->nr_jobs != 1) fprintf(out, "\tjobs %u\n", wp->nr_jobs);
+
+		for (uint32_t j = 0; j < wp->nr_acquires; j++) {
+			const struct sim_workload_acquire *wa = was + wp->first_acquire + j;
+
+			if (wa->resource & SIM_WORKLOAD_IO) {
+				fprintf(out, "\tio %u %u %u\n", wa->at, wa->duration,
+						wa->resource & ~SIM_WORKLOAD_IO);
+			} else {
+				fprintf(out, "\t%s %u %u %u\n",
+						(wa->resource & SIM_WORKLOAD_SHARED) ?
+							"acquire-shared" : "acquire",
+						wa->resource & ~SIM_WORKLOAD_SHARED,
+						wa->at, wa->duration);
+			}
+		}
+		fprintf(out, "end\n\n");
+	}
+	converted = true;
+out:
+	munmap(map, st.st_size);
+	return converted;
+}
+
+static void __print_usage(char * const name)
+{
+	printf("Usage: %s {-t} {-o file} [input file]\n", name);
+	printf("\n");
+	printf("  Convert the process script into the binary workload to -o file\n");
+	printf("  -t: Convert the binary workload into the process script instead\n");
+	printf("  -o: Write to file instead of stdout; required for the binary workload\n");
+	printf("\n");
+}
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	bool to_script = false;
+	char *outfile = NULL;
+	FILE *in, *out;
+	bool converted;
+
+	while ((opt = getopt(argc, argv, "to:h")) != -1) {
+		switch (opt) {
+		case 't':
+			to_script = true;
+			break;
+		case 'o':
+			outfile = optarg;
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 1 != argc || (!to_script && !outfile)) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	in = fopen(argv[optind], to_script ? "rb" : "r");
+	if (!in) {
+		fprintf(stderr, "Cannot open %s\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if (outfile) {
+		out = fopen(outfile, to_script ? "w" : "wb");
+		if (!out) {
+			fprintf(stderr, "Cannot open %s\n", outfile);
+			fclose(in);
+			return EXIT_FAILURE;
+		}
+	} else {
+		out = stdout;
+	}
+
+	if (to_script) {
+		converted = __binary_to_script(in, out);
+	} else {
+		converted = __script_to_binary(in, out);
+	}
+
+	fclose(in);
+	if (out != stdout && fclose(out)) converted = false;
+
+	return converted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
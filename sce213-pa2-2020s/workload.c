@@ -0,0 +1,283 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+/***********************************************************************
+ * Synthetic workload generator
+ *
+ * DESCRIPTION
+ *   Write a process script for sched, sampling the processes from the
+ *   given distributions. The same options and seed generate the same
+ *   script.
+ *
+ *   Arrivals are Poisson; the inter-arrival times are exponential with the
+ *   mean of -a. Lifespans follow one of
+ *
+ *     exp:MEAN                  exponential
+ *     pareto:MIN:ALPHA          Pareto, heavy-tailed for small ALPHA
+ *     bimodal:SHORT:LONG:P      SHORT with probability P, LONG otherwise
+ *
+ *   and priorities are uniform in -p LOW:HIGH. With probability -A, a
+ *   process acquires up to -K resources out of the first -R ones; the
+ *   fewer resources and the more acquisitions, the more contention. With
+ *   probability -S, an acquisition is shared (acquire-shared) rather than
+ *   exclusive. Each process acquires resources in the increasing order of
+ *   their IDs and ages, so the generated workloads never deadlock.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "types.h"
+#include "list_head.h"
+#include "pqueue.h"
+#include "process.h"
+#include "resource.h"
+
+#define MAX_LIFESPAN	1000000
+
+enum lifespan_kind {
+	LIFESPAN_EXP,
+	LIFESPAN_PARETO,
+	LIFESPAN_BIMODAL,
+};
+
+struct lifespan_dist {
+	enum lifespan_kind kind;
+	double params[3];
+};
+
+static unsigned long long seed = 1;
+
+/* xorshift64* */
+static unsigned long long __random(void)
+{
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+	return seed * 2685821657736338717ULL;
+}
+
+/**
+ * Uniform in (0, 1]
+ */
+static double __uniform(void)
+{
+	return ((__random() >> 11) + 1) * (1.0 / (1ULL << 53));
+}
+
+static unsigned int __uniform_int(unsigned int low, unsigned int high)
+{
+	return low + __random() % (high - low + 1);
+}
+
+static double __exponential(double mean)
+{
+	return -mean * log(__uniform());
+}
+
+static unsigned int __sample_lifespan(struct lifespan_dist *dist)
+{
+	double x = 0;
+
+	switch (dist->kind) {
+	case LIFESPAN_EXP:
+		x = __exponential(dist->params[0]);
+		break;
+	case LIFESPAN_PARETO:
+		x = dist->params[0] / pow(__uniform(), 1.0 / dist->params[1]);
+		break;
+	case LIFESPAN_BIMODAL:
+		x = __uniform() <= dist->params[2] ? dist->params[0] : dist->params[1];
+		break;
+	}
+
+	if (x < 1) return 1;
+	if (x > MAX_LIFESPAN) return MAX_LIFESPAN;
+	return (unsigned int)(x + 0.5);
+}
+
+static bool __parse_lifespan(char *spec, struct lifespan_dist *dist)
+{
+	char *kind = strtok(spec, ":");
+	int nr_params = 0;
+	char *param;
+
+	if (!kind) return false;
+
+	while (nr_params < 3 && (param = strtok(NULL, ":"))) {
+		dist->params[nr_params++] = atof(param);
+	}
+
+	if (strcmp(kind, "exp") == 0 && nr_params == 1) {
+		dist->kind = LIFESPAN_EXP;
+		return dist->params[0] > 0;
+	} else if (strcmp(kind, "pareto") == 0 && nr_params == 2) {
+		dist->kind = LIFESPAN_PARETO;
+		return dist->params[0] > 0 && dist->params[1] > 0;
+	} else if (strcmp(kind, "bimodal") == 0 && nr_params == 3) {
+		dist->kind = LIFESPAN_BIMODAL;
+		return dist->params[2] >= 0 && dist->params[2] <= 1;
+	}
+	return false;
+}
+
+/**
+ * Acquire @nr_acquires distinct resources out of @nr_resources in the
+ * increasing order of the IDs, at increasing ages within @lifespan
+ */
+static void __write_acquires(FILE *out, unsigned int lifespan,
+		unsigned int nr_resources, unsigned int nr_acquires,
+		double shared_probability)
+{
+	unsigned int resource = 0;
+	unsigned int at = 0;
+
+	for (unsigned int i = 0; i < nr_acquires; i++) {
+		unsigned int left = nr_acquires - i;
+
+		/* Leave enough resources and ticks for the rest */
+		if (resource + left > nr_resources || at + left > lifespan) break;
+
+		resource = __uniform_int(resource, nr_resources - left);
+		at = __uniform_int(at, lifespan - left);
+
+		fprintf(out, "\t%s %u %u %u\n",
+				shared_probability > 0 && __uniform() <= shared_probability ?
+					"acquire-shared" : "acquire",
+				resource, at, __uniform_int(1, lifespan - at));
+		resource++;
+		at++;
+	}
+}
+
+static void __print_usage(char * const name)
+{
+	printf("Usage: %s {-n processes} {-s seed} {-a interarrival} {-l lifespan} {-p low:high}\n", name);
+	printf("          {-R resources} {-A probability} {-K acquires} {-S probability} {-o file}\n");
+	printf("\n");
+	printf("  -n: Number of processes (default: 100)\n");
+	printf("  -s: Seed of the random numbers (default: 1)\n");
+	printf("  -a: Mean inter-arrival time in ticks of Poisson arrivals (default: 4)\n");
+	printf("  -l: Lifespan distribution; exp:MEAN, pareto:MIN:ALPHA, or\n");
+	printf("      bimodal:SHORT:LONG:P (default: exp:5)\n");
+	printf("  -p: Range of the uniform priorities, up to %d (default: 0:10)\n", MAX_PRIO);
+	printf("  -R: Number of resources to contend for, up to %d (default: 4)\n", MAX_RESOURCES);
+	printf("  -A: Probability that a process acquires resources (default: 0.3)\n");
+	printf("  -K: Maximum number of resources a process acquires (default: 2)\n");
+	printf("  -S: Probability that an acquisition is shared (default: 0)\n");
+	printf("  -o: Write the script to file instead of stdout\n");
+	printf("\n");
+}
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	unsigned long nr_processes = 100;
+	double interarrival = 4;
+	char lifespan_spec[] = "exp:5";
+	struct lifespan_dist lifespan;
+	unsigned int prio_low = 0, prio_high = 10;
+	unsigned int nr_resources = 4;
+	double acquire_probability = 0.3;
+	unsigned int max_acquires = 2;
+	double shared_probability = 0;
+	FILE *out = stdout;
+	double now = 0;
+
+	__parse_lifespan(lifespan_spec, &lifespan);
+
+	while ((opt = getopt(argc, argv, "n:s:a:l:p:R:A:K:S:o:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr_processes = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'a':
+			interarrival = atof(optarg);
+			break;
+		case 'l':
+			if (!__parse_lifespan(optarg, &lifespan)) {
+				fprintf(stderr, "Invalid lifespan distribution %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'p':
+			if (sscanf(optarg, "%u:%u", &prio_low, &prio_high) != 2 ||
+					prio_low > prio_high || prio_high > MAX_PRIO) {
+				fprintf(stderr, "Invalid priority range %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'R':
+			nr_resources = atoi(optarg);
+			break;
+		case 'A':
+			acquire_probability = atof(optarg);
+			break;
+		case 'K':
+			max_acquires = atoi(optarg);
+			break;
+		case 'S':
+			shared_probability = atof(optarg);
+			break;
+		case 'o':
+			out = fopen(optarg, "w");
+			if (!out) {
+				fprintf(stderr, "Cannot open %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'h':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (interarrival < 0 || nr_resources > MAX_RESOURCES) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* Scramble small seeds, and xorshift never leaves 0 */
+	seed = seed * 0x9e3779b97f4a7c15ULL + 1;
+	if (!seed) seed = 1;
+
+	for (unsigned long pid = 1; pid <= nr_processes; pid++) {
+		unsigned int lifespan_ticks = __sample_lifespan(&lifespan);
+
+		fprintf(out, "process %lu\n", pid);
+		fprintf(out, "\tstart %.0f\n", floor(now));
+		fprintf(out, "\tlifespan %u\n", lifespan_ticks);
+		fprintf(out, "\tprio %u\n", __uniform_int(prio_low, prio_high));
+
+		if (nr_resources && max_acquires && __uniform() <= acquire_probability) {
+			__write_acquires(out, lifespan_ticks, nr_resources,
+					__uniform_int(1, max_acquires), shared_probability);
+		}
+		fprintf(out, "end\n\n");
+
+		if (interarrival > 0) now += __exponential(interarrival);
+	}
+
+	if (out != stdout) fclose(out);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#include <stdint.h>
+
+/***********************************************************************
+ * Binary workload
+ *
+ * DESCRIPTION
+ *   Compact alternative to the process script for large workloads. The
+ *   file begins with struct sim_workload_header, followed by the process
+ *   table of @nr_processes struct sim_workload_process, the acquire
+ *   table of @nr_acquires struct sim_workload_acquire, and the resource
+ *   table of @nr_resources struct sim_workload_resource, all in the byte
+ *   order of the machine. The acquisitions of a process are the
+ *   @nr_acquires entries from @first_acquire of the acquire table, in the
+ *   script order, with SIM_WORKLOAD_SHARED set in @resource if shared.
+ *   The I/Os of the process are there too, with SIM_WORKLOAD_IO set in
+ *   @resource along with the device. Devices in @prio_devices queue the
+ *   requests by the priority (see struct sim_device in sim.h). The
+ *   resource table lists the resources of more than one unit.
+ *
+ *   The records are fixed-width, so sim_load_script() maps the file and
+ *   builds all the processes in one allocation without parsing a line.
+ *   It tells the binary workload from the script by the magic. wlconv
+ *   converts the script into the binary workload and back.
+ */
+#define SIM_WORKLOAD_MAGIC	0x4c574853	/* "SHWL" in little endian */
+#define SIM_WORKLOAD_VERSION	3
+
+#define SIM_WORKLOAD_IO		0x80000000
+#define SIM_WORKLOAD_SHARED	0x40000000
+
+struct sim_workload_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nr_processes;
+	uint32_t nr_acquires;
+	uint32_t prio_devices;	/* Bitmap of the devices */
+	uint32_t nr_resources;
+};
+
+struct sim_workload_process {
+	uint32_t pid;
+	uint32_t start;
+	uint32_t lifespan;
+	uint32_t prio;
+	uint32_t deadline;	/* Relative to @start. 0 if none */
+	uint32_t period;	/* 0 if not periodic */
+	uint32_t nr_jobs;
+	uint32_t first_acquire;
+	uint32_t nr_acquires;
+	uint32_t reserved;
+};
+
+struct sim_workload_acquire {
+	uint32_t resource;
+	uint32_t at;
+	uint32_t duration;
+};
+
+struct sim_workload_resource {
+	uint32_t resource;
+	uint32_t units;
+};
+
+#endif